@@ -0,0 +1,11 @@
+/*
+ * clip -tiny command line argument parser-
+ * Copyright (c) 2014 Giemsa/MithrilWorks.
+ *
+ * explicit instantiation of clip for common value types.
+ * compile this file into your project and define CLIP_EXTERN_TEMPLATES
+ * in translation units including clip.hpp.
+ */
+
+#define CLIP_INSTANTIATE_TEMPLATES
+#include "clip.hpp"
@@ -0,0 +1,17 @@
+/*
+ * clip -tiny command line argument parser-
+ * Copyright (c) 2014 Giemsa/MithrilWorks.
+ *
+ * C++20 module interface of clip, re-exports the header unit of clip.hpp.
+ * build the header unit with CLIP_EXTERN_TEMPLATES and link clip.cpp. with g++ (12 or later):
+ *
+ *     g++ -std=c++20 -fmodules-ts -DCLIP_EXTERN_TEMPLATES -fmodule-header -c ./clip.hpp
+ *     g++ -std=c++20 -fmodules-ts -c -x c++ clip.cppm -o clip-module.o
+ *     g++ -std=c++20 -c clip.cpp
+ *
+ *     import clip;
+ */
+
+export module clip;
+
+export import "clip.hpp";
@@ -35,15 +35,60 @@
 #   define nullptr NULL
 #endif
 
+// dynamic exception specification is removed in C++17
+#if __cplusplus >= 201703L
+#   define MW_THROW(e)
+#else
+#   define MW_THROW(e) throw(e)
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#   define MW_POSIX
+#endif
+
+// out-of-line definitions are compiled once in clip.cpp when CLIP_EXTERN_TEMPLATES is used
+#if defined(CLIP_EXTERN_TEMPLATES) || defined(CLIP_INSTANTIATE_TEMPLATES)
+#   define MW_INLINE
+#else
+#   define MW_INLINE inline
+#endif
+
 #include <exception>
+#include <stdexcept>
+#include <typeinfo>
+#include <algorithm>
+#include <string>
 #include <vector>
-#include <iomanip>
+#include <list>
+#include <iterator>
+#include <limits>
+#include <utility>
 #include <iostream>
 #include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+
+#ifdef MW_CPP11
+#   include <atomic>
+#   include <memory>
+#   include <type_traits>
+#endif
+
+#ifdef MW_POSIX
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
 
 namespace clip
 {
     class Parser;
+    class BatchResult;
+    template<typename T> class Flag;
 
 #ifdef MW_CPP11
     enum class ParseResult
@@ -61,6 +106,50 @@ namespace clip
     };
 #endif
 
+#ifdef MW_CPP11
+    enum class MapAdvice
+    {
+        Normal,
+        Sequential,
+        Random,
+        WillNeed
+    };
+#else
+    enum MapAdvice
+    {
+        MapAdvice_Normal,
+        MapAdvice_Sequential,
+        MapAdvice_Random,
+        MapAdvice_WillNeed
+    };
+#endif
+
+#ifdef MW_CPP11
+    enum class ParseError : unsigned char
+    {
+        None,
+        InvalidName,
+        FewArguments,
+        InvalidType,
+        Missing,
+        Constraint,
+        HelpRequested,
+        Source
+    };
+#else
+    enum ParseError
+    {
+        ParseError_None,
+        ParseError_InvalidName,
+        ParseError_FewArguments,
+        ParseError_InvalidType,
+        ParseError_Missing,
+        ParseError_Constraint,
+        ParseError_HelpRequested,
+        ParseError_Source
+    };
+#endif
+
     namespace detail
     {
         template<typename T>
@@ -69,31 +158,153 @@ namespace clip
             static const std::size_t getUID() { return reinterpret_cast<std::size_t>(&getUID); }
         };
 
+        template<typename T> struct CharPointer { };
+        template<> struct CharPointer<const char *> final { typedef int type; };
+        template<> struct CharPointer<char *> final { typedef int type; };
+
+        /* label string, refers string literal without copy or owns a copy of other strings */
+        class Label final
+        {
+        private:
+            const char *str_;
+            unsigned int size_;
+            bool owned_;
+
+            void copy(const char *str, const std::size_t size)
+            {
+                char *p = new char[size + 1];
+                std::memcpy(p, str, size + 1);
+                str_ = p;
+                size_ = static_cast<unsigned int>(size);
+                owned_ = true;
+            }
+
+            void release() { if(owned_) { delete[] str_; } }
+        public:
+            // const char arrays are string literals or constants which outlive the option
+            template<std::size_t N>
+            Label(const char (&str)[N])
+            : str_(str), size_(static_cast<unsigned int>(std::strlen(str))), owned_(false)
+            { }
+
+            // strings which may be freed or modified later are copied
+            template<std::size_t N>
+            Label(char (&str)[N]) { copy(str, std::strlen(str)); }
+
+            template<typename P>
+            Label(const P &str, typename CharPointer<P>::type = 0) { copy(str, std::strlen(str)); }
+
+            Label(const std::string &str) { copy(str.c_str(), str.size()); }
+
+            Label(const Label &other)
+            : str_(other.str_), size_(other.size_), owned_(false)
+            {
+                if(other.owned_) { copy(other.str_, other.size_); }
+            }
+
+            Label &operator=(const Label &other)
+            {
+                if(this != &other)
+                {
+                    release();
+                    str_ = other.str_;
+                    size_ = other.size_;
+                    owned_ = false;
+                    if(other.owned_) { copy(other.str_, other.size_); }
+                }
+
+                return *this;
+            }
+
+            ~Label() { release(); }
+
+            const char *c_str() const { return str_; }
+            std::size_t size() const { return size_; }
+            bool empty() const { return size_ == 0; }
+            std::string str() const { return std::string(str_, size_); }
+            operator std::string() const { return str(); }
+
+            bool operator==(const char *str) const { return std::strcmp(str_, str) == 0; }
+            bool operator!=(const char *str) const { return !(*this == str); }
+            bool operator==(const std::string &str) const { return str.size() == size_ && std::memcmp(str_, str.data(), size_) == 0; }
+            bool operator!=(const std::string &str) const { return !(*this == str); }
+        };
+
+        inline bool operator==(const char *lhs, const Label &rhs) { return rhs == lhs; }
+        inline bool operator!=(const char *lhs, const Label &rhs) { return rhs != lhs; }
+        inline bool operator==(const std::string &lhs, const Label &rhs) { return rhs == lhs; }
+        inline bool operator!=(const std::string &lhs, const Label &rhs) { return rhs != lhs; }
+        inline std::string operator+(const Label &lhs, const char *rhs) { return lhs.str().append(rhs); }
+        inline std::string operator+(const Label &lhs, const std::string &rhs) { return lhs.str().append(rhs); }
+        inline std::string operator+(const char *lhs, const Label &rhs) { return std::string(lhs).append(rhs.c_str(), rhs.size()); }
+        inline std::string operator+(const std::string &lhs, const Label &rhs) { return std::string(lhs).append(rhs.c_str(), rhs.size()); }
+        inline std::ostream &operator<<(std::ostream &os, const Label &label) { return os << label.c_str(); }
+
+        class ColumnBase;
+
+        /* source of a value, later layers override earlier ones */
+        enum Layer
+        {
+            Layer_Default,
+            Layer_Config,
+            Layer_Environment,
+            Layer_CommandLine
+        };
+
         class Base
         {
             friend clip::Parser;
+            template<typename T> friend class clip::Flag;
         private:
             std::size_t uid_;
-            std::string name_, desc_;
+            Label name_, desc_;
             bool optional_, set_, ref_;
+            unsigned char layer_;
 
             template<typename T>
             bool is() const { return uid_ == TypeID<T>::getUID(); }
             std::size_t getUID() const { return uid_; }
-            bool isSet() const { return set_; }
-            virtual void buildArguments(std::ostringstream &oss) const = 0;
+            virtual void buildArguments(std::string &str) const = 0;
+            virtual void clearValue() = 0;
+            virtual Base *clone() const = 0;
+            virtual ColumnBase *createColumn() const = 0;
+            virtual void storeValue(ColumnBase &column) const = 0;
+
+            void reset()
+            {
+                clearValue();
+                set_ = false;
+                layer_ = Layer_Default;
+            }
+
+            bool assign(const char *value, const Layer layer)
+            {
+                // value from lower layer never overrides
+                if(layer < layer_) { return true; }
+                if(layer > layer_ || (layer != Layer_CommandLine && !isMultiArg()))
+                {
+                    reset();
+                    layer_ = static_cast<unsigned char>(layer);
+                }
+
+                return setValue(value);
+            }
         protected:
             bool used(const bool f) { return set_ = !f; }
+            // for multiple argument, values accepted before are kept even if this one failed
+            bool added(const bool f) { set_ = set_ || !f; return !f; }
+            bool isSet() const { return set_; }
         public:
-            Base(const std::size_t uid, const char *name, const char *desc, const bool optional)
-            : uid_(uid), name_(name), desc_(desc), ref_(false), set_(false), optional_(optional)
+            Base(const std::size_t uid, const Label &name, const Label &desc, const bool optional)
+            : uid_(uid), name_(name), desc_(desc), optional_(optional), set_(false), ref_(false), layer_(Layer_Default)
             { }
             virtual ~Base() { }
 
             virtual bool setValue(const char *value) = 0;
             virtual bool isMultiArg() const { return false; }
-            const std::string &getName() const { return name_; }
-            const std::string &getDesc() const { return desc_; }
+            virtual void reserve(const std::size_t) { }
+            const Label &getName() const { return name_; }
+            const Label &getDesc() const { return desc_; }
             bool isOptional() const { return optional_; }
         };
 
@@ -102,12 +313,12 @@ namespace clip
             friend class clip::Parser;
         private:
             char key_;
-            std::string longkey_;
+            Label longkey_;
 
         public:
             OptionBase(
-                const std::size_t uid, const char key, const char *longkey, const char *name,
-                const char *desc, const bool optional
+                const std::size_t uid, const char key, const Label &longkey, const Label &name,
+                const Label &desc, const bool optional
             )
             : Base(uid, name, desc, optional), key_(key), longkey_(longkey)
             { }
@@ -115,14 +326,23 @@ namespace clip
             virtual ~OptionBase() { }
 
             char getKey() const { return key_; }
-            const std::string &getLongKey() const { return longkey_; }
+            const Label &getLongKey() const { return longkey_; }
+
+            // "-k", or "--longkey" for long only option(key is 0)
+            std::string getSwitch() const { return key_ != 0 ? std::string(1, '-').append(1, key_) : "--" + longkey_; }
+            std::string getDisplayName() const { return key_ != 0 ? getSwitch() + "(" + longkey_ + ")" : getSwitch(); }
+
+            // converted value for config snapshot, false if the type has no binary form.
+            // deserialize replaces the value, or appends to it for multiple argument
+            virtual bool serialize(std::string &) const { return false; }
+            virtual bool deserialize(const char *, const std::size_t) { return false; }
         };
 
         class ArgumentBase : public Base
         {
             friend class clip::Parser;
         public:
-            ArgumentBase(const std::size_t uid, const char *name, const char *desc, const bool optional)
+            ArgumentBase(const std::size_t uid, const Label &name, const Label &desc, const bool optional)
             : Base(uid, name, desc, optional)
             { }
 
@@ -143,9 +363,14 @@ namespace clip
         {
         private:
             const char *key_;
+            std::size_t size_;
         public:
-            LongKeyComparator(const char *key) : key_(key) { }
-            bool operator()(const OptionBase *option) const { return key_ == option->getLongKey(); }
+            LongKeyComparator(const char *key, const std::size_t size) : key_(key), size_(size) { }
+            bool operator()(const OptionBase *option) const
+            {
+                const Label &longkey = option->getLongKey();
+                return longkey.size() == size_ && std::memcmp(longkey.c_str(), key_, size_) == 0;
+            }
         };
 
         class NameComparator
@@ -162,631 +387,3350 @@ namespace clip
             bool operator()(const OptionBase *lhs, const OptionBase *rhs) const { return lhs->getKey() < rhs->getKey(); }
         };
 
+        struct LongKeySort
+        {
+            static int compare(const char *lhs, const std::size_t lsize, const char *rhs, const std::size_t rsize)
+            {
+                const int r = std::memcmp(lhs, rhs, std::min(lsize, rsize));
+                return r != 0 ? r : (lsize < rsize ? -1 : (lsize > rsize ? 1 : 0));
+            }
+
+            bool operator()(const OptionBase *lhs, const OptionBase *rhs) const
+            {
+                const Label &l = lhs->getLongKey(), &r = rhs->getLongKey();
+                return compare(l.c_str(), l.size(), r.c_str(), r.size()) < 0;
+            }
+        };
+
         struct Separator
         {
             bool operator()(const char c) const { return c == '\\' || c == '/'; }
         };
-    }
-
-    /* option */
-    template<typename T>
-    class Option final : public detail::OptionBase
-    {
-    private:
-        T value_, defaultValue_;
 
-        bool setValue(const char *value) override
+        /* append words with wrapping at width(0 is unlimited), wrapped lines are indented */
+        class TextWriter final
         {
-            std::stringstream ss(value);
-            ss >> value_;
-            return used(ss.fail());
-        }
+        private:
+            std::string &str_;
+            std::size_t width_, indent_, column_;
+            bool empty_;
 
-        void buildArguments(std::ostringstream &oss) const override
-        {
-            if(isOptional()) { oss << "[-" << getKey() << " <" << getName() << ">] "; }
-            else             { oss <<  "-" << getKey() << " <" << getName() << "> ";  }
-        }
+            void newline()
+            {
+                str_ += '\n';
+                str_.append(indent_, ' ');
+                column_ = indent_;
+                empty_ = true;
+            }
+        public:
+            TextWriter(std::string &str, const std::size_t width)
+            : str_(str), width_(width), indent_(0), column_(0), empty_(true)
+            { }
 
-    public:
-        Option(const char key, const char *longkey, const char *name, const char *desc)
-        : detail::OptionBase(detail::TypeID<T>::getUID(), key, longkey, name, desc, false)
-        , value_(T()), defaultValue_(T())
-        { }
+            // start writing after text of column characters
+            void begin(const std::size_t column, const std::size_t indent)
+            {
+                column_ = column;
+                indent_ = indent;
+                empty_ = true;
+            }
 
-        Option(const char key, const char *longkey, const char *name, const char *desc, const T &defaultValue)
-        : detail::OptionBase(detail::TypeID<T>::getUID(), key, longkey, name, desc, true)
-        , value_(T()), defaultValue_(defaultValue)
-        { }
+            void word(const char *str, const std::size_t size)
+            {
+                if(!empty_)
+                {
+                    if(width_ && column_ + 1 + size > width_) { newline(); }
+                    else { str_ += ' '; ++column_; }
+                }
 
-        T getValue() const { return value_; }
-    };
+                str_.append(str, size);
+                column_ += size;
+                empty_ = false;
+            }
 
-    /* option specialized for switch */
-    template<>
-    class Option<bool> final : public detail::OptionBase
-    {
-    private:
-        bool value_, defaultValue_;
+            void text(const char *str)
+            {
+                while(*str)
+                {
+                    if(*str == '\n') { newline(); ++str; continue; }
+                    if(*str == ' ')  { ++str; continue; }
 
-        bool setValue(const char *value) override
-        {
-            value_ = true;
-            return used(false);
-        }
+                    const char *last = str;
+                    while(*last && *last != ' ' && *last != '\n') { ++last; }
+                    word(str, last - str);
+                    str = last;
+                }
+            }
+
+            void end() { str_ += '\n'; }
+        };
 
-        void buildArguments(std::ostringstream &oss) const override
+        /* read-only view of a whole file, memory mapped if possible */
+        class FileView final
         {
-            if(isOptional()) { oss << "[-" << getKey() << "] "; }
-            else             { oss <<  "-" << getKey() << " "; }
-        }
+        private:
+            const char *data_;
+            std::size_t size_;
+            unsigned long long modified_;
+            bool mapped_;
+            std::vector<char> buffer_;
+
+            FileView(const FileView &);
+            FileView &operator=(const FileView &);
+        public:
+            FileView() : data_(nullptr), size_(0), modified_(0), mapped_(false) { }
+            ~FileView() { close(); }
 
-    public:
-        Option(const char key, const char *longkey, const char *desc)
-        : detail::OptionBase(detail::TypeID<bool>::getUID(), key, longkey, "", desc, true)
-        , value_(false), defaultValue_(false)
-        { }
+            bool open(const char *path)
+            {
+                close();
+#ifdef MW_POSIX
+                const int fd = ::open(path, O_RDONLY);
+                if(fd < 0) { return false; }
 
-        Option(const char key, const char *longkey, const char *desc, const bool defaultValue)
-        : detail::OptionBase(detail::TypeID<bool>::getUID(), key, longkey, "", desc, true)
-        , value_(false), defaultValue_(defaultValue)
-        { }
+                struct stat st;
+                if(::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+                {
+                    ::close(fd);
+                    return false;
+                }
 
-        bool getValue() const { return value_; }
-    };
+                size_ = static_cast<std::size_t>(st.st_size);
+#   if defined(__linux__)
+                modified_ = static_cast<unsigned long long>(st.st_mtim.tv_sec) * 1000000000ULL + st.st_mtim.tv_nsec;
+#   elif defined(__APPLE__)
+                modified_ = static_cast<unsigned long long>(st.st_mtimespec.tv_sec) * 1000000000ULL + st.st_mtimespec.tv_nsec;
+#   else
+                modified_ = static_cast<unsigned long long>(st.st_mtime) * 1000000000ULL;
+#   endif
+                if(size_ > 0)
+                {
+                    void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if(p != MAP_FAILED)
+                    {
+                        data_ = static_cast<const char *>(p);
+                        mapped_ = true;
+                    }
+                }
 
-    /* option specialized for multiple argument */
-    template<typename T>
-    class Option<std::vector<T> > final : public detail::OptionBase
-    {
-    private:
-        std::vector<T> value_, defaultValue_;
+                ::close(fd);
+                if(size_ > 0 && !mapped_) { size_ = 0; return false; }
+                if(!data_) { data_ = ""; }
+                return true;
+#else
+                std::FILE *fp = std::fopen(path, "rb");
+                if(!fp) { return false; }
+                char chunk[4096];
+                for(std::size_t n; (n = std::fread(chunk, 1, sizeof(chunk), fp)) > 0; ) { buffer_.insert(buffer_.end(), chunk, chunk + n); }
+                std::fclose(fp);
+                buffer_.push_back('\0');
+                data_ = &buffer_[0];
+                size_ = buffer_.size() - 1;
+                return true;
+#endif
+            }
 
-        bool setValue(const char *value) override
+            void close()
+            {
+#ifdef MW_POSIX
+                if(mapped_) { ::munmap(const_cast<char *>(data_), size_); }
+#endif
+                data_ = nullptr;
+                size_ = 0;
+                modified_ = 0;
+                mapped_ = false;
+                buffer_.clear();
+            }
+
+            void advise(const int advice) const
+            {
+#ifdef MW_POSIX
+                if(mapped_) { ::madvise(const_cast<char *>(data_), size_, advice); }
+#else
+                (void)advice;
+#endif
+            }
+
+            const char *data() const { return data_; }
+            std::size_t size() const { return size_; }
+            unsigned long long getModified() const { return modified_; }
+        };
+
+        /* 64bit FNV-1a */
+        inline unsigned long long hash(const void *data, const std::size_t size, unsigned long long h = 14695981039346656037ULL)
         {
-            T tmp;
-            std::stringstream ss(value);
-            ss >> tmp;
-            value_.push_back(tmp);
-            return used(ss.fail());
+            const unsigned char *p = static_cast<const unsigned char *>(data);
+            for(std::size_t i = 0; i < size; ++i)
+            {
+                h = (h ^ p[i]) * 1099511628211ULL;
+            }
+
+            return h;
         }
 
-        void buildArguments(std::ostringstream &oss) const override
+        /* header of pre-parsed config snapshot */
+        struct SnapshotHeader
         {
-            if(isOptional()) { oss << "[-" << getKey() << " <" << getName() << "...>] "; }
-            else             { oss <<  "-" << getKey() << " <" << getName() << "...> ";  }
-        }
+            char magic[8];
+            unsigned long long fileSize, modified, schema;
+        };
 
-        bool isMultiArg() const override { return true; }
-    public:
-        Option(const char key, const char *longkey, const char *name, const char *desc)
-        : detail::OptionBase(detail::TypeID<std::vector<T> >::getUID(), key, longkey, name, desc, false)
-        , value_(false)
-        { }
+        /* binary form of converted values stored in snapshot, types without it are stored as text */
+        template<typename T, bool Arithmetic = std::numeric_limits<T>::is_specialized>
+        struct Codec final
+        {
+            static const bool enabled = false;
+            static bool write(std::string &, const T &) { return false; }
+            static bool read(const char *&, const char *, T &) { return false; }
+        };
 
-        Option(const char key, const char *longkey, const char *name, const char *desc, const std::vector<T> &defaultValue)
-        : detail::OptionBase(detail::TypeID<std::vector<T> >::getUID(), key, longkey, name, desc, true)
-        , value_(false), defaultValue_(defaultValue)
-        { }
+        template<typename T>
+        struct Codec<T, true> final
+        {
+            static const bool enabled = true;
 
-        std::vector<T> getValue() const { return value_; }
-    };
+            static bool write(std::string &out, const T &value)
+            {
+                out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+                return true;
+            }
 
-    template<typename T>
-    class Argument final : public detail::ArgumentBase
-    {
-    private:
-        T value_, defaultValue_;
+            static bool read(const char *&p, const char *end, T &value)
+            {
+                if(static_cast<std::size_t>(end - p) < sizeof(T)) { return false; }
+                std::memcpy(&value, p, sizeof(T));
+                p += sizeof(T);
+                return true;
+            }
+        };
 
-        bool setValue(const char *value) override
+        template<>
+        struct Codec<std::string, false> final
         {
-            std::stringstream ss(value);
-            ss >> value_;
-            return used(ss.fail());
-        }
+            static const bool enabled = true;
+
+            static bool write(std::string &out, const std::string &value)
+            {
+                Codec<unsigned int>::write(out, static_cast<unsigned int>(value.size()));
+                out.append(value);
+                return true;
+            }
+
+            static bool read(const char *&p, const char *end, std::string &value)
+            {
+                unsigned int size;
+                if(!Codec<unsigned int>::read(p, end, size) || static_cast<std::size_t>(end - p) < size) { return false; }
+                value.assign(p, size);
+                p += size;
+                return true;
+            }
+        };
 
-        void buildArguments(std::ostringstream &oss) const override
+        template<typename T>
+        struct Codec<std::vector<T>, false> final
         {
-            if(isOptional()) { oss << "[" << getName() << "] "; }
-            else             { oss <<        getName() << " ";  }
-        }
-    public:
-        Argument(const char *name, const char *desc)
-        : ArgumentBase(detail::TypeID<T>::getUID(), name, desc, false)
-        , value_(T()), defaultValue_(T())
-        { }
+            static const bool enabled = Codec<T>::enabled;
 
-        Argument(const char *name, const char *desc, const T &defaultValue)
-        : ArgumentBase(detail::TypeID<T>::getUID(), name, desc, true)
-        , value_(T()), defaultValue_(defaultValue)
-        { }
+            static bool write(std::string &out, const std::vector<T> &value)
+            {
+                if(!enabled) { return false; }
+                Codec<unsigned int>::write(out, static_cast<unsigned int>(value.size()));
+                for(std::size_t i = 0; i < value.size(); ++i) { Codec<T>::write(out, value[i]); }
+                return true;
+            }
 
-        T getValue() const { return value_; }
-    };
+            static bool read(const char *&p, const char *end, std::vector<T> &value)
+            {
+                unsigned int size;
+                if(!Codec<unsigned int>::read(p, end, size)) { return false; }
+                value.clear();
+                value.reserve(std::min<std::size_t>(size, end - p));
+                for(unsigned int i = 0; i < size; ++i)
+                {
+                    T tmp;
+                    if(!Codec<T>::read(p, end, tmp)) { return false; }
+                    value.push_back(tmp);
+                }
 
-    template<typename T>
-    class Argument<std::vector<T> > final : public detail::ArgumentBase
-    {
-    private:
-        std::vector<T> value_, defaultValue_;
+                return true;
+            }
+        };
 
-        bool isMultiArg() const override { return true; }
-        bool setValue(const char *value) override
+        // whole data should be consumed
+        template<typename T>
+        inline bool decode(const char *data, const std::size_t size, T &value)
         {
-            T tmp;
-            std::stringstream ss(value);
-            ss >> tmp;
-            value_.push_back(tmp);
-            return used(ss.fail());
+            const char *end = data + size;
+            return Codec<T>::read(data, end, value) && data == end;
         }
 
-        void buildArguments(std::ostringstream &oss) const override
+        /* bitmask over option indices */
+        typedef unsigned long long Word;
+        static const std::size_t WordBits = sizeof(Word) * 8;
+
+        inline std::size_t popcount(Word w)
         {
-            if(isOptional()) { oss << "[" << getName() << "...] "; }
-            else             { oss <<        getName() << "... ";  }
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<std::size_t>(__builtin_popcountll(w));
+#else
+            w = w - ((w >> 1) & 0x5555555555555555ULL);
+            w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+            w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+            return static_cast<std::size_t>((w * 0x0101010101010101ULL) >> 56);
+#endif
         }
-    public:
-        Argument(const char *name, const char *desc)
-        : ArgumentBase(detail::TypeID<std::vector<T> >::getUID(), name, desc, false)
-        { }
 
-        Argument(const char *name, const char *desc, const std::vector<T> &defaultValue)
-        : ArgumentBase(detail::TypeID<std::vector<T> >::getUID(), name, desc, true)
-        , defaultValue_(defaultValue)
-        { }
+        inline std::size_t lowestBit(const Word w)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<std::size_t>(__builtin_ctzll(w));
+#else
+            std::size_t n = 0;
+            while(!((w >> n) & 1)) { ++n; }
+            return n;
+#endif
+        }
 
-        std::vector<T> getValue() const { return value_; }
-    };
-
-    class Parser final
-    {
-        typedef std::vector<detail::OptionBase *> OptionList;
-        typedef std::vector<detail::ArgumentBase *> ArgumentList;
-        enum ArgType
+        struct KeyRef
         {
-            ArgType_Value,
-            ArgType_Key,
-            ArgType_LongKey
+            char key;
+            const char *longkey;
         };
 
-    private:
-        std::string description_, appName_, usage_;
-        std::ostringstream errorMsg_;
-        OptionList options_;
-        ArgumentList arguments_;
-        bool dirty_, showErrors_, varg_;
-
-        template<typename T>
-        void clear(T &list)
-        {
-            for(typename T::const_iterator it = list.begin(); it != list.end(); ++it)
-            {
-                if(!(*it)->ref_) { delete *it; }
-            }
-
-            list.clear();
-        }
-
-        void init()
-        {
-            options_.push_back(
-                new Option<bool>(
-                    'h',
-                    "help",
-                    "display usage and information.",
-                    false
-                )
-            );
-        }
-
-        void setAppName(const std::string &str)
+        enum TokenType
         {
-            appName_.assign(
-                std::find_if(str.rbegin(), str.rend(), detail::Separator()).base(),
-                str.end()
-            );
-        }
+            TokenType_Value,
+            TokenType_Key,
+            TokenType_LongKey
+        };
 
-        template<typename T, typename U>
-        typename T::value_type find(const T &begin, const T &end, const U& comp) const
+        /*
+         * command line classified before dispatch, current token is program name at first.
+         * only one type byte is stored for each token. argv is referred as is, and NUL separated
+         * buffer is walked in place without building array of pointers.
+         */
+        class TokenIndex final
         {
-            const T it = std::find_if(begin, end, comp);
-            return it == end ? nullptr : *it;
-        }
-
-        detail::OptionBase *findByKey(const char key) const { return find(options_.begin(), options_.end(), detail::KeyComparator(key)); }
-        detail::OptionBase *findByLongKey(const char *key) const { return find(options_.begin(), options_.end(), detail::LongKeyComparator(key)); }
-        detail::ArgumentBase *findByName(const char *name) const { return find(arguments_.begin(), arguments_.end(), detail::NameComparator(name)); }
+        private:
+            const char *const *strs_;
+            const char *current_, *tail_;
+            std::vector<unsigned char> types_;
+            std::string last_;
+            std::size_t index_;
 
-        ArgType checkType(const char *key) const
-        {
-            if(*key == '-')
+            static unsigned char classify(const char *str)
             {
-                if(*++key == '-') { return ArgType_LongKey; }
-                return ArgType_Key;
+                if(str[0] != '-') { return TokenType_Value; }
+                return str[1] == '-' ? TokenType_LongKey : TokenType_Key;
             }
 
-            return ArgType_Value;
-        }
+            // token starting at p in buffer, only the last token without NUL is copied
+            const char *token(const char *p) const { return p == tail_ ? last_.c_str() : p; }
+        public:
+            TokenIndex() : strs_(nullptr), current_(nullptr), tail_(nullptr), index_(0) { }
 
-        bool parseArguments(ParseResult &r, int &i, const int argc, const char *argv[], detail::OptionBase *option, const char *key)
-        {
-            if(!option)
+            void assign(const int argc, const char *const *argv)
             {
-                errorMsg_ << "invalid argument name specified: " << key << "\n";
-                r = end();
-                return true;
+                strs_ = argv;
+                types_.resize(static_cast<std::size_t>(argc));
+                for(std::size_t i = 0; i < types_.size(); ++i) { types_[i] = classify(argv[i]); }
+                index_ = 0;
             }
 
-            if(option->isMultiArg())
+            void assign(const char *buffer, const std::size_t size)
             {
-                for(++i; i < argc; ++i)
+                strs_ = nullptr;
+                tail_ = nullptr;
+                types_.clear();
+
+                const char *p = buffer, *end = buffer + size;
+                while(p != end)
                 {
-                    const char *value = argv[i];
-                    if(checkType(value) != ArgType_Value)
+                    const char *q = static_cast<const char *>(std::memchr(p, '\0', end - p));
+                    if(!q)
                     {
-                        --i;
+                        last_.assign(p, end);
+                        tail_ = p;
+                        types_.push_back(classify(last_.c_str()));
                         break;
                     }
 
-                    if(!option->setValue(value))
-                    {
-                        r = invalidTypeError(option);
-                        return true;
-                    }
+                    types_.push_back(classify(p));
+                    p = q + 1;
                 }
+
+                current_ = token(buffer);
+                index_ = 0;
             }
-            else
-            {
-                if(option->is<bool>())
-                {
-                    option->setValue(nullptr);
-                    return false;
-                }
 
-                if(++i < argc)
-                {
-                    const char *value = argv[i];
-                    if(checkType(value) == ArgType_Value)
-                    {
-                        if(option->isSet() || !option->setValue(value))
-                        {
-                            r = fewArgError(option);
-                            return true;
-                        }
-                    }
-                }
-                else
-                {
-                    r = fewArgError(option);
-                    return true;
-                }
+            bool empty() const { return types_.empty(); }
+            bool advance()
+            {
+                if(++index_ >= types_.size()) { return false; }
+                if(!strs_) { current_ = token(current_ + std::strlen(current_) + 1); }
+                return true;
             }
 
-            return false;
-        }
+            const char *current() const { return strs_ ? strs_[index_] : current_; }
+            TokenType type() const { return static_cast<TokenType>(types_[index_]); }
 
-        bool showHelp()
-        {
-            const detail::OptionBase *option = findByKey('h');
-            if(option && option->is<bool>() && static_cast<const Option<bool> *>(option)->getValue())
+            // number of value tokens following current token
+            std::size_t countValues() const
             {
-                showUsage();
-                return true;
+                std::size_t i = index_ + 1;
+                while(i < types_.size() && types_[i] == TokenType_Value) { ++i; }
+                return i - index_ - 1;
             }
+        };
+    }
 
-            return false;
-        }
+    /* list of options used by constraints, specified by key or long key */
+    class Keys final
+    {
+        friend class Parser;
+    private:
+        std::vector<detail::KeyRef> keys_;
+    public:
+        Keys(const char key) { (*this)(key); }
+        Keys(const char *longkey) { (*this)(longkey); }
 
-        ParseResult fewArgError(const detail::OptionBase *option)
+        Keys &operator()(const char key)
         {
-            errorMsg_ << "argument should be specified for -" << option->getKey() << "(" << option->getLongKey() << ")"<< "\n";
-            return end();
+            const detail::KeyRef ref = { key, nullptr };
+            keys_.push_back(ref);
+            return *this;
         }
 
-        ParseResult invalidTypeError(const detail::OptionBase *option)
+        Keys &operator()(const char *longkey)
         {
-            errorMsg_ << "invalid type was specified for -" << option->getKey() << "(" << option->getLongKey() << ")\n";
-            return end();
+            const detail::KeyRef ref = { 0, longkey };
+            keys_.push_back(ref);
+            return *this;
         }
+    };
 
-        ParseResult end()
-        {
-            if(showHelp()) { return ENUM_ELEM(ParseResult, HelpShown); }
-            const bool r = getErrorMessage().empty();
-            if(showErrors_ && !r)
-            {
-                std::cerr << getErrorMessage() << std::endl;
-            }
+    namespace detail
+    {
+        /* element type stored in column, bool is stored as byte to keep column contiguous */
+        template<typename T>
+        struct ColumnStorage final { typedef T type; };
 
-            return r ? ENUM_ELEM(ParseResult, Success) : ENUM_ELEM(ParseResult, Failure);
-        }
+        template<>
+        struct ColumnStorage<bool> final { typedef unsigned char type; };
 
-        template<typename T, typename U>
-        T getValue(const detail::Base *base) const throw(std::bad_cast)
+        inline void pushBit(std::vector<Word> &bits, const std::size_t size, const bool f)
         {
-            if(!base->is<T>()) { throw std::bad_cast(); }
-            return std::move(static_cast<const U *>(base)->getValue());
+            if(size % WordBits == 0) { bits.push_back(0); }
+            bits.back() |= Word(f) << (size % WordBits);
         }
 
-        Parser &add(detail::OptionBase *option) throw(std::runtime_error)
+        inline void appendBits(std::vector<Word> &bits, const std::size_t size, const std::vector<Word> &other, const std::size_t otherSize)
         {
-            if(!findByKey(option->getKey()) && !findByLongKey(option->getLongKey().c_str()))
-            {
-                options_.push_back(option);
-                dirty_ = true;
-            }
-            else
+            for(std::size_t i = 0; i < otherSize; ++i)
             {
-                throw std::runtime_error("key is already registered in option list.");
+                pushBit(bits, size + i, (other[i / WordBits] >> (i % WordBits)) & 1);
             }
-
-            return *this;
         }
 
-        Parser &add(detail::ArgumentBase *arg) throw(std::runtime_error)
+        class ColumnBase
         {
-            if(varg_) { throw std::runtime_error("argument added after variable arguments."); }
-            if(!findByName(arg->getName().c_str()))
-            {
-                arguments_.push_back(arg);
-                if(arg->isMultiArg()) { varg_ = true; }
-                dirty_ = true;
-            }
-            else
-            {
-                throw std::runtime_error("name is already registered in argument list.");
-            }
+            friend class clip::Parser;
+            friend class clip::BatchResult;
+        private:
+            std::size_t uid_;
+        protected:
+            std::vector<Word> set_;
+            std::size_t rows_;
 
-            return *this;
+            void pushRow(const bool set) { pushBit(set_, rows_++, set); }
+            virtual void append(const ColumnBase &other) = 0;
+        public:
+            ColumnBase(const std::size_t uid) : uid_(uid), rows_(0) { }
+            virtual ~ColumnBase() { }
+
+            std::size_t size() const { return rows_; }
+            bool isSet(const std::size_t row) const { return (set_[row / WordBits] >> (row % WordBits)) & 1; }
+            // bitmap of rows that the option was specified, bit i of word i / 64 is row i
+            const Word *getSetBitmap() const { return set_.empty() ? nullptr : &set_[0]; }
+        };
+    }
+
+    /* values of an option in all rows of batch */
+    template<typename T>
+    class Column final : public detail::ColumnBase
+    {
+        friend class Parser;
+    public:
+        typedef typename detail::ColumnStorage<T>::type value_type;
+    private:
+        std::vector<value_type> values_;
+
+        void append(const detail::ColumnBase &other) override
+        {
+            const Column &c = static_cast<const Column &>(other);
+            values_.insert(values_.end(), c.values_.begin(), c.values_.end());
+            detail::appendBits(set_, rows_, c.set_, c.rows_);
+            rows_ += c.rows_;
         }
     public:
-        Parser()
-        : dirty_(true), showErrors_(false), varg_(false)
-        { init(); }
+        Column() : detail::ColumnBase(detail::TypeID<T>::getUID()) { }
 
-        Parser(const char *desc)
-        : description_(desc), dirty_(true), showErrors_(true), varg_(false)
-        { init(); }
+        void push(const T &value, const bool set)
+        {
+            values_.push_back(value);
+            pushRow(set);
+        }
 
-        Parser(const char *desc, const bool showErrors)
-        : description_(desc), dirty_(true), showErrors_(showErrors), varg_(false)
-        { init(); }
+        const value_type *data() const { return values_.empty() ? nullptr : &values_[0]; }
+        const value_type &operator[](const std::size_t row) const { return values_[row]; }
+    };
 
-        ~Parser()
+    /* values of multiple argument option, values of row i are data()[getOffsets()[i]] to data()[getOffsets()[i + 1]] */
+    template<typename T>
+    class Column<std::vector<T> > final : public detail::ColumnBase
+    {
+        friend class Parser;
+    public:
+        typedef typename detail::ColumnStorage<T>::type value_type;
+    private:
+        std::vector<value_type> values_;
+        std::vector<std::size_t> offsets_;
+
+        void append(const detail::ColumnBase &other) override
         {
-            clear(options_);
-            clear(arguments_);
+            const Column &c = static_cast<const Column &>(other);
+            const std::size_t base = values_.size();
+            values_.insert(values_.end(), c.values_.begin(), c.values_.end());
+            for(std::size_t i = 1; i < c.offsets_.size(); ++i) { offsets_.push_back(base + c.offsets_[i]); }
+            detail::appendBits(set_, rows_, c.set_, c.rows_);
+            rows_ += c.rows_;
         }
+    public:
+        Column() : detail::ColumnBase(detail::TypeID<std::vector<T> >::getUID()), offsets_(1, 0) { }
 
-        ParseResult parse(const int argc, const char *argv[])
+        void push(const std::vector<T> &value, const bool set)
         {
-            ArgumentList::iterator it = arguments_.begin();
-            setAppName(argv[0]);
+            values_.insert(values_.end(), value.begin(), value.end());
+            offsets_.push_back(values_.size());
+            pushRow(set);
+        }
 
-            for(int i = 1; i < argc; ++i)
-            {
-                const char *arg = argv[i];
-                switch(checkType(arg))
-                {
-                    case ArgType_Value:
-                        {
-                            if(arguments_.empty()) { break; }
-                            if(it == arguments_.end())
-                            {
-                                detail::ArgumentBase *a = *(it - 1);
-                                if(a->isMultiArg()) { a->setValue(arg); }
-                            }
-                            else
-                            {
-                                (*it++)->setValue(arg);
-                            }
-                        }
-                        break;
-                    case ArgType_Key:
-                        {
-                            const char *keys = arg + 1;
-                            if(strlen(keys) == 1)
-                            {
-                                // argument mode
-                                ParseResult r;
-                                char kn[2] = { *keys, 0 };
-                                if(parseArguments(r, i, argc, argv, findByKey(*keys), kn))
-                                {
-                                    return r;
-                                }
-                            }
-                            else
-                            {
-                                // switch mode
-                                while(*keys)
-                                {
-                                    detail::OptionBase *option = findByKey(*keys);
-                                    if(!option)
-                                    {
-                                        errorMsg_ << "invalid argument name specified: -" << *keys << "\n";
-                                        return end();
-                                    }
+        const value_type *data() const { return values_.empty() ? nullptr : &values_[0]; }
+        const std::size_t *getOffsets() const { return &offsets_[0]; }
+        std::size_t count(const std::size_t row) const { return offsets_[row + 1] - offsets_[row]; }
+        const value_type *begin(const std::size_t row) const { return data() + offsets_[row]; }
+        const value_type *end(const std::size_t row) const { return data() + offsets_[row + 1]; }
+    };
 
-                                    if(option->is<bool>())
-                                    {
-                                        if(!option->setValue(nullptr))
-                                        {
-                                            return invalidTypeError(option);
-                                        }
-                                    }
-                                    else
-                                    {
-                                        return invalidTypeError(option);
-                                    }
+    namespace detail
+    {
+        // lock for rare updates shared between threads(global flags, first mapping of files),
+        // std::mutex is hidden in out-of-line definitions
+        MW_INLINE void lockGlobal();
+        MW_INLINE void unlockGlobal();
 
-                                    ++keys;
-                                }
-                            }
+        class GlobalLock final
+        {
+        private:
+            GlobalLock(const GlobalLock &);
+            GlobalLock &operator=(const GlobalLock &);
+        public:
+            GlobalLock() { lockGlobal(); }
+            ~GlobalLock() { unlockGlobal(); }
+        };
+    }
 
-                        }
-                        break;
-                    case ArgType_LongKey:
-                        {
-                            ParseResult r;
-                            if(parseArguments(r, i, argc, argv, findByLongKey(arg + 2), arg))
-                            {
-                                return r;
-                            }
-                        }
-                        break;
-                }
-            }
+    /*
+     * read-only file given as option value.
+     * existence is checked when parsed, and the file is mapped on first access.
+     * copies share one mapping, which is created once even if threads access it at the same time.
+     */
+    class MappedFile final
+    {
+    private:
+        struct State
+        {
+#ifdef MW_CPP11
+            std::atomic<std::size_t> refs;
+#else
+            std::size_t refs;
+#endif
+            std::string path;
+            detail::FileView view;
+            MapAdvice advice;
+#ifdef MW_CPP11
+            std::atomic<bool> mapped;
+#else
+            bool mapped;
+#endif
+        };
 
-            for(OptionList::const_iterator it = options_.begin(); it != options_.end(); ++it)
-            {
-                const detail::OptionBase *option = *it;
-                if(!option->isSet() && !option->isOptional())
-                {
-                    errorMsg_ << "-" << option->getKey() << "(" << option->getLongKey() << ") should be specified.\n";
-                    return end();
-                }
-            }
+        State *state_;
+
+        void release()
+        {
+            if(state_ && --state_->refs == 0) { delete state_; }
+            state_ = nullptr;
+        }
+
+        bool isReady() const
+        {
+#ifdef MW_CPP11
+            return state_->mapped.load(std::memory_order_acquire);
+#else
+            return state_->mapped;
+#endif
+        }
+
+        void applyAdvice() const
+        {
+#ifdef MW_POSIX
+            const int advices[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED };
+            state_->view.advise(advices[static_cast<int>(state_->advice)]);
+#endif
+        }
 
-            for(ArgumentList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it)
+        // map on first access, checked again under the lock
+        const State *map() const
+        {
+            if(state_ && !isReady())
             {
-                const detail::ArgumentBase *arg = *it;
-                if(!arg->isSet() && !arg->isOptional())
+                detail::GlobalLock lock;
+                if(!isReady())
                 {
-                    errorMsg_ << arg->getName() << " should be specified.\n";
-                    return end();
+                    if(state_->view.open(state_->path.c_str())) { applyAdvice(); }
+#ifdef MW_CPP11
+                    state_->mapped.store(true, std::memory_order_release);
+#else
+                    state_->mapped = true;
+#endif
                 }
             }
 
-            return end();
+            return state_;
         }
+    public:
+        MappedFile() : state_(nullptr) { }
 
-        std::string getUsage()
+        explicit MappedFile(const std::string &path)
+        : state_(new State())
         {
-            if(dirty_)
-            {
-                std::ostringstream oss;
-                oss << "Usage:\n    " << appName_ << " ";
+            state_->refs = 1;
+            state_->path = path;
+            state_->advice = ENUM_ELEM(MapAdvice, Normal);
+            state_->mapped = false;
+        }
 
-                // sort keys
-                OptionList sorted(options_);
-                std::sort(sorted.begin(), sorted.end(), detail::KeySort());
-                std::size_t olen = 0;
-                for(OptionList::const_iterator it = sorted.begin(); it != sorted.end(); ++it)
-                {
-                    const detail::OptionBase *option = *it;
-                    option->buildArguments(oss);
+        MappedFile(const MappedFile &other)
+        : state_(other.state_)
+        {
+            if(state_) { ++state_->refs; }
+        }
 
-                    olen = std::max(olen, option->getLongKey().size());
-                }
+        MappedFile &operator=(const MappedFile &other)
+        {
+            if(state_ != other.state_)
+            {
+                release();
+                state_ = other.state_;
+                if(state_) { ++state_->refs; }
+            }
 
-                std::size_t alen = 0;
-                for(ArgumentList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it)
-                {
-                    const detail::ArgumentBase *arg = *it;
-                    arg->buildArguments(oss);
+            return *this;
+        }
 
-                    alen = std::max(alen, arg->getName().size());
-                }
+        ~MappedFile() { release(); }
 
-                // build arguments
-                {
-                    alen += 2;
-                    oss << "\n\nArguments:\n";
+        bool empty() const { return !state_; }
+        bool isMapped() const { return state_ && isReady() && state_->view.data(); }
+        std::string getPath() const { return state_ ? state_->path : std::string(); }
 
-                    for(ArgumentList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it)
-                    {
-                        const detail::ArgumentBase *arg = *it;
-                        oss << "    " << std::setw(static_cast<int>(alen)) << std::left << arg->getName() << "  ";
-                        if(arg->isOptional()) { oss << "(optional) "; }
-                        oss << arg->getDesc() << "\n";
-                    }
-                }
+        // contents of the file, nullptr if the file cannot be mapped
+        const char *data() const
+        {
+            const State *state = map();
+            return state ? state->view.data() : nullptr;
+        }
 
-                // build options
-                {
-                    olen += 2;
-                    oss << "\nOptions:\n";
+        std::size_t size() const
+        {
+            const State *state = map();
+            return state ? state->view.size() : 0;
+        }
 
-                    for(OptionList::const_iterator it = sorted.begin(); it != sorted.end(); ++it)
-                    {
-                        const detail::OptionBase *option = *it;
-                        oss <<
-                            "    -" << option->getKey() << "  " <<
-                            std::setw(static_cast<int>(olen)) << std::left <<
-                            ("--" + option->getLongKey()) << "  ";
-                        if(option->isOptional() && option->getKey() != 'h')
+        // hint for access pattern, applied at mapping if the file is not mapped yet
+        void advise(const MapAdvice advice) const
+        {
+            if(!state_) { return; }
+            detail::GlobalLock lock;
+            state_->advice = advice;
+            if(isReady()) { applyAdvice(); }
+        }
+    };
+
+    /*
+     * set of integers stored as sorted runs of "first, first + step, ..., last".
+     * spans of runs never overlap, so membership test is a binary search and
+     * iteration generates values on the fly.
+     * ranges of different steps overlapping in a pattern too large to expand are kept
+     * as a group, a run of step 0 whose values are the union of its parts.
+     */
+    template<typename T>
+    class IntervalSet final
+    {
+    public:
+        typedef unsigned long long distance_type;
+
+        struct Interval
+        {
+            T first, last;
+            distance_type step;
+        };
+
+        class const_iterator final
+        {
+            friend class IntervalSet;
+        private:
+            const IntervalSet *set_;
+            const Interval *run_, *end_;
+            const std::vector<Interval> *parts_;
+            T value_;
+
+            const_iterator(const IntervalSet *set, const Interval *run, const Interval *end)
+            : set_(set), run_(run), end_(end), parts_(nullptr), value_(T())
+            { enter(); }
+
+            void enter()
+            {
+                parts_ = run_ != end_ && run_->step == 0 ? &set_->findGroup(run_->first).parts : nullptr;
+                value_ = run_ != end_ ? run_->first : T();
+            }
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const T *pointer;
+            typedef const T &reference;
+
+            const_iterator() : set_(nullptr), run_(nullptr), end_(nullptr), parts_(nullptr), value_(T()) { }
+
+            const T &operator*() const { return value_; }
+            const T *operator->() const { return &value_; }
+
+            const_iterator &operator++()
+            {
+                if(value_ == run_->last) { ++run_; enter();                             }
+                else if(parts_)          { lowest(*parts_, advance(value_, 1), value_); }
+                else                     { value_ = advance(value_, run_->step);        }
+                return *this;
+            }
+
+            const_iterator operator++(int)
+            {
+                const const_iterator it = *this;
+                ++*this;
+                return it;
+            }
+
+            bool operator==(const const_iterator &other) const { return run_ == other.run_ && value_ == other.value_; }
+            bool operator!=(const const_iterator &other) const { return !(*this == other); }
+        };
+
+        typedef const_iterator iterator;
+        typedef T value_type;
+    private:
+        typedef typename std::vector<Interval>::iterator RunIterator;
+
+        // parts of a run of step 0. each part has values through the whole span of the run
+        struct Group
+        {
+            T first;
+            distance_type count;
+            std::vector<Interval> parts;
+        };
+
+        std::vector<Interval> runs_;
+        std::vector<Group> groups_;
+
+        static distance_type distance(const T from, const T to) { return static_cast<distance_type>(to) - static_cast<distance_type>(from); }
+        static T advance(const T value, const distance_type n) { return static_cast<T>(static_cast<distance_type>(value) + n); }
+        static bool lastLess(const Interval &run, const T &value) { return run.last < value; }
+        static bool firstGreater(const T &value, const Interval &run) { return value < run.first; }
+        static bool groupLess(const Group &group, const T &first) { return group.first < first; }
+        static bool groupOrder(const Group &a, const Group &b) { return a.first < b.first; }
+
+        const Group &findGroup(const T first) const { return *std::lower_bound(groups_.begin(), groups_.end(), first, groupLess); }
+
+        static Interval makeRun(const T first, const T last, const distance_type step)
+        {
+            const Interval run = { first, last, first == last ? 1 : step };
+            return run;
+        }
+
+        // values of run in [from, to]
+        static bool clip(const Interval &run, const T from, const T to, Interval &result)
+        {
+            if(to < run.first || run.last < from) { return false; }
+
+            const distance_type head = from <= run.first ? 0 : distance(run.first, from);
+            const distance_type tail = run.last <= to ? distance(run.first, run.last) : distance(run.first, to);
+            const distance_type first = (head / run.step + (head % run.step != 0)) * run.step;
+            const distance_type last = tail / run.step * run.step;
+            if(first > last) { return false; }
+
+            result = makeRun(advance(run.first, first), advance(run.first, last), run.step);
+            return true;
+        }
+
+        static distance_type gcd(distance_type a, distance_type b)
+        {
+            while(b != 0) { const distance_type r = a % b; a = b; b = r; }
+            return a;
+        }
+
+        // lcm of steps of pieces, or false if it is larger than limit
+        static bool period(const std::vector<Interval> &pieces, const distance_type limit, distance_type &result)
+        {
+            result = 1;
+            for(std::size_t i = 0; i < pieces.size(); ++i)
+            {
+                const distance_type step = pieces[i].step / gcd(result, pieces[i].step);
+                if(result > limit / step) { return false; }
+                result *= step;
+            }
+            return true;
+        }
+
+        // union of pieces as one run, if it is evenly spaced. each piece keeps the step of its run spanning [from, to]
+        static bool interleave(const std::vector<Interval> &pieces, const T from, const T to, Interval &result)
+        {
+            distance_type length;
+            if(!period(pieces, MaxExpanded, length)) { return false; }
+
+            std::vector<bool> hit(static_cast<std::size_t>(length), false);
+            for(std::size_t i = 0; i < pieces.size(); ++i)
+            {
+                for(distance_type o = distance(from, pieces[i].first); o < length; o += pieces[i].step) { hit[static_cast<std::size_t>(o)] = true; }
+            }
+
+            distance_type head = 0, gap = 0, count = 0, prev = 0;
+            for(distance_type o = 0; o < length; ++o)
+            {
+                if(!hit[static_cast<std::size_t>(o)]) { continue; }
+                if(count == 0)      { head = o;       }
+                else if(count == 1) { gap = o - prev; }
+                else if(o - prev != gap) { return false; }
+                prev = o;
+                ++count;
+            }
+            if(count == 1) { gap = length; }
+            if(gap * count != length) { return false; }
+
+            const T first = advance(from, head);
+            result = makeRun(first, advance(first, distance(first, to) / gap * gap), gap);
+            return true;
+        }
+
+        // drop pieces whose values are all in another piece
+        static void reduce(std::vector<Interval> &pieces)
+        {
+            for(std::size_t i = 0; i < pieces.size(); )
+            {
+                const Interval &a = pieces[i];
+                bool covered = false;
+                for(std::size_t j = 0; j < pieces.size() && !covered; ++j)
+                {
+                    const Interval &b = pieces[j];
+                    const bool equal = a.first == b.first && a.last == b.last && (a.first == a.last || a.step == b.step);
+                    covered = j != i && (!equal || j < i) && b.first <= a.first && a.last <= b.last &&
+                        (a.first == a.last || a.step % b.step == 0) && distance(b.first, a.first) % b.step == 0;
+                }
+                if(covered) { pieces.erase(pieces.begin() + i); }
+                else        { ++i;                              }
+            }
+        }
+
+        // smallest value of parts not less than from
+        static bool lowest(const std::vector<Interval> &parts, const T from, T &result)
+        {
+            bool found = false;
+            for(std::size_t i = 0; i < parts.size(); ++i)
+            {
+                const Interval &part = parts[i];
+                if(part.last < from) { continue; }
+
+                const distance_type head = from <= part.first ? 0 : distance(part.first, from);
+                const T value = advance(part.first, (head / part.step + (head % part.step != 0)) * part.step);
+                if(!found || value < result) { result = value; found = true; }
+            }
+            return found;
+        }
+
+        // number of values of parts in [from, to]
+        static distance_type count(const std::vector<Interval> &parts, const T from, const T to)
+        {
+            distance_type n = 0;
+            T value;
+            for(bool found = lowest(parts, from, value); found && value <= to; found = value != to && lowest(parts, advance(value, 1), value)) { ++n; }
+            return n;
+        }
+
+        // the union repeats every lcm of steps from the first value, so values of one period are counted once
+        static distance_type count(const Group &group, const T last)
+        {
+            const distance_type span = distance(group.first, last);
+            distance_type length;
+            if(!period(group.parts, span, length)) { return count(group.parts, group.first, last); }
+
+            const distance_type full = span / length;
+            return full * count(group.parts, group.first, advance(group.first, length - 1)) +
+                count(group.parts, advance(group.first, full * length), last);
+        }
+
+        // append run placed after runs, joining it to the last run if possible
+        static void append(std::vector<Interval> &runs, Interval run)
+        {
+            if(!runs.empty())
+            {
+                Interval &back = runs.back();
+                const distance_type gap = distance(back.last, run.first);
+                const bool backSingle = back.first == back.last;
+                const bool runSingle = run.first == run.last;
+
+                if(runSingle && (backSingle || gap == back.step))
+                {
+                    back.step = backSingle ? gap : back.step;
+                    back.last = run.last;
+                    return;
+                }
+
+                if(gap == run.step)
+                {
+                    if(backSingle || back.step == run.step)
+                    {
+                        back.step = run.step;
+                        back.last = run.last;
+                        return;
+                    }
+
+                    // pair of values joined earlier fits better to this run
+                    if(advance(back.first, back.step) == back.last)
+                    {
+                        run.first = back.last;
+                        back = makeRun(back.first, back.first, 1);
+                    }
+                }
+            }
+
+            runs.push_back(run);
+        }
+    public:
+        IntervalSet() { }
+
+        // most values stored one by one for a single insert, larger overlaps are kept as groups
+        static const distance_type MaxExpanded = 4096;
+
+        void insert(const T value) { insert(value, value, 1); }
+
+        void insert(const IntervalSet &other)
+        {
+            for(std::size_t i = 0; i < other.runs_.size(); ++i)
+            {
+                const Interval &run = other.runs_[i];
+                if(run.step != 0) { insert(run.first, run.last, run.step); continue; }
+
+                const std::vector<Interval> &parts = other.getParts(run);
+                for(std::size_t j = 0; j < parts.size(); ++j) { insert(parts[j].first, parts[j].last, parts[j].step); }
+            }
+        }
+
+        // add first, first + step, ... up to last. first <= last and step > 0 are required.
+        void insert(const T first, const T last, const distance_type step = 1)
+        {
+            const Interval run = makeRun(first, advance(first, distance(first, last) / step * step), step);
+
+            RunIterator lo = std::lower_bound(runs_.begin(), runs_.end(), run.first, lastLess);
+            RunIterator hi = lo;
+            while(hi != runs_.end() && hi->first <= run.last) { ++hi; }
+
+            std::vector<Interval> result;
+            std::vector<Group> groups;
+            std::vector<T> replaced;
+            if(lo != runs_.begin()) { result.push_back(*--lo); ++lo; }
+
+            if(lo == hi)
+            {
+                append(result, run);
+            }
+            else
+            {
+                // split overlapped span at the boundaries of runs and rebuild each segment.
+                // groups are split into their parts
+                std::vector<Interval> overlapped;
+                std::vector<T> cuts;
+                T spanLast = run.last;
+                for(RunIterator it = lo; ; ++it)
+                {
+                    const Interval &span = it != hi ? *it : run;
+                    cuts.push_back(span.first);
+                    if(span.last != std::numeric_limits<T>::max()) { cuts.push_back(advance(span.last, 1)); }
+                    spanLast = std::max(spanLast, span.last);
+
+                    if(span.step != 0)
+                    {
+                        overlapped.push_back(span);
+                    }
+                    else
+                    {
+                        const std::vector<Interval> &parts = getParts(span);
+                        overlapped.insert(overlapped.end(), parts.begin(), parts.end());
+                        replaced.push_back(span.first);
+                    }
+                    if(it == hi) { break; }
+                }
+                std::sort(cuts.begin(), cuts.end());
+                cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+                std::vector<Interval> pieces;
+                std::vector<T> values;
+                distance_type expanded = 0;
+                for(std::size_t i = 0; i < cuts.size() && cuts[i] <= spanLast; ++i)
+                {
+                    const T from = cuts[i];
+                    const T to = i + 1 < cuts.size() ? advance(cuts[i + 1], static_cast<distance_type>(-1)) : spanLast;
+
+                    pieces.clear();
+                    bool dense = false;
+                    for(std::size_t j = 0; j < overlapped.size(); ++j)
+                    {
+                        Interval piece;
+                        if(!clip(overlapped[j], from, to, piece)) { continue; }
+                        piece.step = overlapped[j].step;
+                        dense = dense || piece.step == 1;
+                        pieces.push_back(piece);
+                    }
+
+                    if(pieces.empty()) { continue; }
+                    if(dense) { append(result, makeRun(from, to, 1)); continue; }
+
+                    reduce(pieces);
+                    if(pieces.size() == 1) { append(result, makeRun(pieces[0].first, pieces[0].last, pieces[0].step)); continue; }
+
+                    // runs with different steps are interleaved. the union repeats every lcm of steps,
+                    // so it is a single run when values in one period are evenly spaced
+                    Interval merged;
+                    if(interleave(pieces, from, to, merged)) { append(result, merged); continue; }
+
+                    // otherwise expand values in this segment, up to MaxExpanded values per insert
+                    distance_type n = 0;
+                    for(std::size_t j = 0; j < pieces.size(); ++j) { n += distance(pieces[j].first, pieces[j].last) / pieces[j].step + 1; }
+                    if(n <= MaxExpanded - expanded)
+                    {
+                        expanded += n;
+                        values.clear();
+                        for(std::size_t j = 0; j < pieces.size(); ++j)
+                        {
+                            for(T v = pieces[j].first; ; v = advance(v, pieces[j].step))
+                            {
+                                values.push_back(v);
+                                if(v == pieces[j].last) { break; }
+                            }
+                        }
+                        std::sort(values.begin(), values.end());
+                        values.erase(std::unique(values.begin(), values.end()), values.end());
+                        for(std::size_t j = 0; j < values.size(); ++j) { append(result, makeRun(values[j], values[j], 1)); }
+                        continue;
+                    }
+
+                    // or keep pieces as a group
+                    Group group;
+                    group.first = pieces[0].first;
+                    T last = pieces[0].last;
+                    for(std::size_t j = 1; j < pieces.size(); ++j)
+                    {
+                        group.first = std::min(group.first, pieces[j].first);
+                        last = std::max(last, pieces[j].last);
+                    }
+                    group.parts = pieces;
+                    group.count = count(group, last);
+                    groups.push_back(group);
+
+                    const Interval marker = { group.first, last, 0 };
+                    append(result, marker);
+                }
+            }
+
+            if(hi != runs_.end()) { append(result, *hi++); }
+            if(lo != runs_.begin()) { --lo; }
+
+            const std::size_t index = lo - runs_.begin();
+            runs_.erase(lo, hi);
+            runs_.insert(runs_.begin() + index, result.begin(), result.end());
+
+            for(std::size_t i = 0; i < replaced.size(); ++i)
+            {
+                groups_.erase(std::lower_bound(groups_.begin(), groups_.end(), replaced[i], groupLess));
+            }
+            if(!groups.empty())
+            {
+                groups_.insert(groups_.end(), groups.begin(), groups.end());
+                std::sort(groups_.begin(), groups_.end(), groupOrder);
+            }
+        }
+
+        bool contains(const T value) const
+        {
+            typename std::vector<Interval>::const_iterator it = std::upper_bound(runs_.begin(), runs_.end(), value, firstGreater);
+            if(it == runs_.begin()) { return false; }
+            --it;
+            if(value > it->last) { return false; }
+            if(it->step != 0)    { return distance(it->first, value) % it->step == 0; }
+
+            T found;
+            return lowest(findGroup(it->first).parts, value, found) && found == value;
+        }
+
+        distance_type size() const
+        {
+            distance_type n = 0;
+            for(std::size_t i = 0; i < runs_.size(); ++i)
+            {
+                n += runs_[i].step != 0 ? distance(runs_[i].first, runs_[i].last) / runs_[i].step + 1 : findGroup(runs_[i].first).count;
+            }
+            return n;
+        }
+
+        bool empty() const { return runs_.empty(); }
+        void clear() { runs_.clear(); groups_.clear(); }
+
+        // runs of step 0 are groups, their values are the union of getParts
+        const std::vector<Interval> &getIntervals() const { return runs_; }
+        const std::vector<Interval> &getParts(const Interval &group) const { return findGroup(group.first).parts; }
+
+        const_iterator begin() const { return runs_.empty() ? const_iterator() : const_iterator(this, &runs_[0], &runs_[0] + runs_.size()); }
+        const_iterator end() const { return runs_.empty() ? const_iterator() : const_iterator(this, &runs_[0] + runs_.size(), &runs_[0] + runs_.size()); }
+    };
+
+    namespace detail
+    {
+        /* conversion from command line string to value */
+        template<typename T>
+        struct Converter final
+        {
+            static bool convert(const char *str, T &value)
+            {
+                std::stringstream ss(str);
+                ss >> value;
+                return !ss.fail();
+            }
+        };
+
+        template<>
+        struct Converter<MappedFile> final
+        {
+            static bool convert(const char *str, MappedFile &value)
+            {
+#ifdef MW_POSIX
+                struct stat st;
+                if(::stat(str, &st) != 0 || !S_ISREG(st.st_mode) || ::access(str, R_OK) != 0) { return false; }
+#else
+                std::FILE *fp = std::fopen(str, "rb");
+                if(!fp) { return false; }
+                std::fclose(fp);
+#endif
+                value = MappedFile(str);
+                return true;
+            }
+        };
+
+        template<typename T, bool Signed = std::numeric_limits<T>::is_signed>
+        struct IntegerParser final
+        {
+            static bool parse(const char *&str, T &value)
+            {
+                const char *digits = *str == '-' ? str + 1 : str;
+                if(!std::isdigit(static_cast<unsigned char>(*digits))) { return false; }
+
+                char *end;
+                errno = 0;
+                const long long v = std::strtoll(str, &end, 10);
+                if(errno == ERANGE || v < std::numeric_limits<T>::min() || v > std::numeric_limits<T>::max()) { return false; }
+
+                str = end;
+                value = static_cast<T>(v);
+                return true;
+            }
+        };
+
+        template<typename T>
+        struct IntegerParser<T, false> final
+        {
+            static bool parse(const char *&str, T &value)
+            {
+                if(!std::isdigit(static_cast<unsigned char>(*str))) { return false; }
+
+                char *end;
+                errno = 0;
+                const unsigned long long v = std::strtoull(str, &end, 10);
+                if(errno == ERANGE || v > std::numeric_limits<T>::max()) { return false; }
+
+                str = end;
+                value = static_cast<T>(v);
+                return true;
+            }
+        };
+
+        template<typename T>
+        struct Codec<IntervalSet<T>, false> final
+        {
+            static const bool enabled = Codec<T>::enabled;
+
+            static bool write(std::string &out, const IntervalSet<T> &value)
+            {
+                // groups are written as their parts
+                typedef typename IntervalSet<T>::Interval Interval;
+                const std::vector<Interval> &runs = value.getIntervals();
+                std::vector<Interval> ranges;
+                for(std::size_t i = 0; i < runs.size(); ++i)
+                {
+                    if(runs[i].step != 0) { ranges.push_back(runs[i]); continue; }
+
+                    const std::vector<Interval> &parts = value.getParts(runs[i]);
+                    ranges.insert(ranges.end(), parts.begin(), parts.end());
+                }
+
+                Codec<unsigned int>::write(out, static_cast<unsigned int>(ranges.size()));
+                for(std::size_t i = 0; i < ranges.size(); ++i)
+                {
+                    Codec<T>::write(out, ranges[i].first);
+                    Codec<T>::write(out, ranges[i].last);
+                    Codec<unsigned long long>::write(out, ranges[i].step);
+                }
+
+                return true;
+            }
+
+            static bool read(const char *&p, const char *end, IntervalSet<T> &value)
+            {
+                unsigned int size;
+                if(!Codec<unsigned int>::read(p, end, size)) { return false; }
+                value.clear();
+                for(unsigned int i = 0; i < size; ++i)
+                {
+                    T first, last;
+                    unsigned long long step;
+                    if(!Codec<T>::read(p, end, first) || !Codec<T>::read(p, end, last) || !Codec<unsigned long long>::read(p, end, step)) { return false; }
+                    if(last < first || step == 0) { return false; }
+                    value.insert(first, last, step);
+                }
+
+                return true;
+            }
+        };
+
+        /* comma separated list of "value", "first-last", "first:last" or "first:last:step" */
+        template<typename T>
+        struct Converter<IntervalSet<T> > final
+        {
+            static bool convert(const char *str, IntervalSet<T> &value)
+            {
+                for(;;)
+                {
+                    T first, last;
+                    unsigned long long step = 1;
+                    if(!IntegerParser<T>::parse(str, first)) { return false; }
+
+                    last = first;
+                    if(*str == '-' || *str == ':')
+                    {
+                        const bool stepped = *str++ == ':';
+                        if(!IntegerParser<T>::parse(str, last)) { return false; }
+                        if(stepped && *str == ':')
+                        {
+                            ++str;
+                            if(!IntegerParser<unsigned long long>::parse(str, step)) { return false; }
+                        }
+                    }
+
+                    if(last < first || step == 0) { return false; }
+                    value.insert(first, last, step);
+
+                    if(*str == 0) { return true; }
+                    if(*str++ != ',') { return false; }
+                }
+            }
+        };
+    }
+
+    /* option */
+    template<typename T>
+    class Option final : public detail::OptionBase
+    {
+    private:
+        T value_, defaultValue_;
+
+        bool setValue(const char *value) override
+        {
+            return used(!detail::Converter<T>::convert(value, value_));
+        }
+
+        void clearValue() override { value_ = T(); }
+        detail::Base *clone() const override { return new Option(*this); }
+        detail::ColumnBase *createColumn() const override { return new Column<T>(); }
+        void storeValue(detail::ColumnBase &column) const override { static_cast<Column<T> &>(column).push(getValue(), isSet()); }
+        bool serialize(std::string &out) const override { return detail::Codec<T>::write(out, value_); }
+        bool deserialize(const char *data, const std::size_t size) override { return used(!detail::decode(data, size, value_)); }
+
+        void buildArguments(std::string &str) const override
+        {
+            const std::string key = getSwitch();
+            if(isOptional()) { str.append("[").append(key).append(" <").append(getName().c_str()).append(">]"); }
+            else             { str.append(key).append(" <").append(getName().c_str()).append(">");             }
+        }
+
+    public:
+        Option(const char key, const detail::Label &longkey, const detail::Label &name, const detail::Label &desc)
+        : detail::OptionBase(detail::TypeID<T>::getUID(), key, longkey, name, desc, false)
+        , value_(T()), defaultValue_(T())
+        { }
+
+        Option(const char key, const detail::Label &longkey, const detail::Label &name, const detail::Label &desc, const T &defaultValue)
+        : detail::OptionBase(detail::TypeID<T>::getUID(), key, longkey, name, desc, true)
+        , value_(T()), defaultValue_(defaultValue)
+        { }
+
+        T getValue() const { return isSet() ? value_ : defaultValue_; }
+    };
+
+    /* option specialized for switch */
+    template<>
+    class Option<bool> final : public detail::OptionBase
+    {
+    private:
+        bool value_, defaultValue_;
+
+        bool setValue(const char *value) override
+        {
+            // switch given without value(command line) is always true
+            if(!value)
+            {
+                value_ = true;
+                return used(false);
+            }
+
+            const char *const truthy[] = { "1", "true", "yes", "on" };
+            const char *const falsy[] = { "0", "false", "no", "off" };
+            for(std::size_t i = 0; i < sizeof(truthy) / sizeof(*truthy); ++i)
+            {
+                if(std::strcmp(value, truthy[i]) == 0) { value_ = true; return used(false); }
+                if(std::strcmp(value, falsy[i]) == 0) { value_ = false; return used(false); }
+            }
+
+            return used(true);
+        }
+
+        void clearValue() override { value_ = false; }
+        detail::Base *clone() const override { return new Option(*this); }
+        detail::ColumnBase *createColumn() const override { return new Column<bool>(); }
+        void storeValue(detail::ColumnBase &column) const override { static_cast<Column<bool> &>(column).push(getValue(), isSet()); }
+        bool serialize(std::string &out) const override { return detail::Codec<bool>::write(out, value_); }
+        bool deserialize(const char *data, const std::size_t size) override { return used(!detail::decode(data, size, value_)); }
+
+        void buildArguments(std::string &str) const override
+        {
+            const std::string key = getSwitch();
+            if(isOptional()) { str.append("[").append(key).append("]"); }
+            else             { str.append(key);                         }
+        }
+
+    public:
+        Option(const char key, const detail::Label &longkey, const detail::Label &desc)
+        : detail::OptionBase(detail::TypeID<bool>::getUID(), key, longkey, "", desc, true)
+        , value_(false), defaultValue_(false)
+        { }
+
+        Option(const char key, const detail::Label &longkey, const detail::Label &desc, const bool defaultValue)
+        : detail::OptionBase(detail::TypeID<bool>::getUID(), key, longkey, "", desc, true)
+        , value_(false), defaultValue_(defaultValue)
+        { }
+
+        bool getValue() const { return isSet() ? value_ : defaultValue_; }
+    };
+
+    /* option specialized for multiple argument */
+    template<typename T>
+    class Option<std::vector<T> > final : public detail::OptionBase
+    {
+    private:
+        std::vector<T> value_, defaultValue_;
+
+        bool setValue(const char *value) override
+        {
+            T tmp;
+            const bool r = detail::Converter<T>::convert(value, tmp);
+            value_.push_back(tmp);
+            return added(!r);
+        }
+
+        void clearValue() override { value_.clear(); }
+        detail::Base *clone() const override { return new Option(*this); }
+        detail::ColumnBase *createColumn() const override { return new Column<std::vector<T> >(); }
+        void storeValue(detail::ColumnBase &column) const override { static_cast<Column<std::vector<T> > &>(column).push(getValue(), isSet()); }
+        bool serialize(std::string &out) const override { return detail::Codec<std::vector<T> >::write(out, value_); }
+        bool deserialize(const char *data, const std::size_t size) override
+        {
+            std::vector<T> values;
+            if(!detail::decode(data, size, values)) { return false; }
+            value_.insert(value_.end(), values.begin(), values.end());
+            return added(false);
+        }
+
+        void buildArguments(std::string &str) const override
+        {
+            const std::string key = getSwitch();
+            if(isOptional()) { str.append("[").append(key).append(" <").append(getName().c_str()).append("...>]"); }
+            else             { str.append(key).append(" <").append(getName().c_str()).append("...>");             }
+        }
+
+        bool isMultiArg() const override { return true; }
+        void reserve(const std::size_t n) override
+        {
+            // keep geometric growth when option is specified repeatedly
+            if(value_.capacity() < value_.size() + n) { value_.reserve(std::max(value_.size() + n, value_.capacity() * 2)); }
+        }
+    public:
+        Option(const char key, const detail::Label &longkey, const detail::Label &name, const detail::Label &desc)
+        : detail::OptionBase(detail::TypeID<std::vector<T> >::getUID(), key, longkey, name, desc, false)
+        , value_(false)
+        { }
+
+        Option(const char key, const detail::Label &longkey, const detail::Label &name, const detail::Label &desc, const std::vector<T> &defaultValue)
+        : detail::OptionBase(detail::TypeID<std::vector<T> >::getUID(), key, longkey, name, desc, true)
+        , value_(false), defaultValue_(defaultValue)
+        { }
+
+        std::vector<T> getValue() const { return isSet() ? value_ : defaultValue_; }
+    };
+
+    /* option specialized for ranges of integer */
+    template<typename T>
+    class Option<IntervalSet<T> > final : public detail::OptionBase
+    {
+    private:
+        IntervalSet<T> value_, defaultValue_;
+
+        bool setValue(const char *value) override
+        {
+            return added(!detail::Converter<IntervalSet<T> >::convert(value, value_));
+        }
+
+        void clearValue() override { value_.clear(); }
+        detail::Base *clone() const override { return new Option(*this); }
+        detail::ColumnBase *createColumn() const override { return new Column<IntervalSet<T> >(); }
+        void storeValue(detail::ColumnBase &column) const override { static_cast<Column<IntervalSet<T> > &>(column).push(getValue(), isSet()); }
+        bool serialize(std::string &out) const override { return detail::Codec<IntervalSet<T> >::write(out, value_); }
+        bool deserialize(const char *data, const std::size_t size) override
+        {
+            IntervalSet<T> values;
+            if(!detail::decode(data, size, values)) { return false; }
+            value_.insert(values);
+            return added(false);
+        }
+
+        void buildArguments(std::string &str) const override
+        {
+            const std::string key = getSwitch();
+            if(isOptional()) { str.append("[").append(key).append(" <").append(getName().c_str()).append("...>]"); }
+            else             { str.append(key).append(" <").append(getName().c_str()).append("...>");             }
+        }
+
+        bool isMultiArg() const override { return true; }
+    public:
+        Option(const char key, const detail::Label &longkey, const detail::Label &name, const detail::Label &desc)
+        : detail::OptionBase(detail::TypeID<IntervalSet<T> >::getUID(), key, longkey, name, desc, false)
+        { }
+
+        Option(const char key, const detail::Label &longkey, const detail::Label &name, const detail::Label &desc, const IntervalSet<T> &defaultValue)
+        : detail::OptionBase(detail::TypeID<IntervalSet<T> >::getUID(), key, longkey, name, desc, true)
+        , defaultValue_(defaultValue)
+        { }
+
+        IntervalSet<T> getValue() const { return isSet() ? value_ : defaultValue_; }
+    };
+
+    template<typename T>
+    class Argument final : public detail::ArgumentBase
+    {
+    private:
+        T value_, defaultValue_;
+
+        bool setValue(const char *value) override
+        {
+            return used(!detail::Converter<T>::convert(value, value_));
+        }
+
+        void clearValue() override { value_ = T(); }
+        detail::Base *clone() const override { return new Argument(*this); }
+        detail::ColumnBase *createColumn() const override { return new Column<T>(); }
+        void storeValue(detail::ColumnBase &column) const override { static_cast<Column<T> &>(column).push(getValue(), isSet()); }
+
+        void buildArguments(std::string &str) const override
+        {
+            if(isOptional()) { str.append("[").append(getName().c_str()).append("]"); }
+            else             { str.append(getName().c_str());                         }
+        }
+    public:
+        Argument(const detail::Label &name, const detail::Label &desc)
+        : ArgumentBase(detail::TypeID<T>::getUID(), name, desc, false)
+        , value_(T()), defaultValue_(T())
+        { }
+
+        Argument(const detail::Label &name, const detail::Label &desc, const T &defaultValue)
+        : ArgumentBase(detail::TypeID<T>::getUID(), name, desc, true)
+        , value_(T()), defaultValue_(defaultValue)
+        { }
+
+        T getValue() const { return isSet() ? value_ : defaultValue_; }
+    };
+
+    template<typename T>
+    class Argument<std::vector<T> > final : public detail::ArgumentBase
+    {
+    private:
+        std::vector<T> value_, defaultValue_;
+
+        bool isMultiArg() const override { return true; }
+        void reserve(const std::size_t n) override
+        {
+            if(value_.capacity() < value_.size() + n) { value_.reserve(std::max(value_.size() + n, value_.capacity() * 2)); }
+        }
+
+        bool setValue(const char *value) override
+        {
+            T tmp;
+            const bool r = detail::Converter<T>::convert(value, tmp);
+            value_.push_back(tmp);
+            return added(!r);
+        }
+
+        void clearValue() override { value_.clear(); }
+        detail::Base *clone() const override { return new Argument(*this); }
+        detail::ColumnBase *createColumn() const override { return new Column<std::vector<T> >(); }
+        void storeValue(detail::ColumnBase &column) const override { static_cast<Column<std::vector<T> > &>(column).push(getValue(), isSet()); }
+
+        void buildArguments(std::string &str) const override
+        {
+            if(isOptional()) { str.append("[").append(getName().c_str()).append("...]"); }
+            else             { str.append(getName().c_str()).append("...");              }
+        }
+    public:
+        Argument(const detail::Label &name, const detail::Label &desc)
+        : ArgumentBase(detail::TypeID<std::vector<T> >::getUID(), name, desc, false)
+        { }
+
+        Argument(const detail::Label &name, const detail::Label &desc, const std::vector<T> &defaultValue)
+        : ArgumentBase(detail::TypeID<std::vector<T> >::getUID(), name, desc, true)
+        , defaultValue_(defaultValue)
+        { }
+
+        std::vector<T> getValue() const { return isSet() ? value_ : defaultValue_; }
+    };
+
+    template<typename T>
+    class Argument<IntervalSet<T> > final : public detail::ArgumentBase
+    {
+    private:
+        IntervalSet<T> value_, defaultValue_;
+
+        bool isMultiArg() const override { return true; }
+        bool setValue(const char *value) override
+        {
+            return added(!detail::Converter<IntervalSet<T> >::convert(value, value_));
+        }
+
+        void clearValue() override { value_.clear(); }
+        detail::Base *clone() const override { return new Argument(*this); }
+        detail::ColumnBase *createColumn() const override { return new Column<IntervalSet<T> >(); }
+        void storeValue(detail::ColumnBase &column) const override { static_cast<Column<IntervalSet<T> > &>(column).push(getValue(), isSet()); }
+
+        void buildArguments(std::string &str) const override
+        {
+            if(isOptional()) { str.append("[").append(getName().c_str()).append("...]"); }
+            else             { str.append(getName().c_str()).append("...");              }
+        }
+    public:
+        Argument(const detail::Label &name, const detail::Label &desc)
+        : ArgumentBase(detail::TypeID<IntervalSet<T> >::getUID(), name, desc, false)
+        { }
+
+        Argument(const detail::Label &name, const detail::Label &desc, const IntervalSet<T> &defaultValue)
+        : ArgumentBase(detail::TypeID<IntervalSet<T> >::getUID(), name, desc, true)
+        , defaultValue_(defaultValue)
+        { }
+
+        IntervalSet<T> getValue() const { return isSet() ? value_ : defaultValue_; }
+    };
+
+    /* result of batch parsing, one column for each option and argument, one row for each command line */
+    class BatchResult final
+    {
+        friend class Parser;
+        typedef std::vector<detail::ColumnBase *> ColumnList;
+    private:
+        ColumnList options_, arguments_;
+        std::string keys_;
+        std::vector<std::string> longkeys_, names_;
+        std::vector<detail::Word> valid_;
+        std::vector<unsigned char> errors_;
+        std::size_t rows_;
+
+        BatchResult(const BatchResult &);
+        BatchResult &operator=(const BatchResult &);
+
+        void clear()
+        {
+            for(ColumnList::const_iterator it = options_.begin(); it != options_.end(); ++it) { delete *it; }
+            for(ColumnList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it) { delete *it; }
+            options_.clear();
+            arguments_.clear();
+            keys_.clear();
+            longkeys_.clear();
+            names_.clear();
+            valid_.clear();
+            errors_.clear();
+            rows_ = 0;
+        }
+
+        void pushRow(const ParseError error)
+        {
+            detail::pushBit(valid_, rows_++, error == ENUM_ELEM(ParseError, None));
+            errors_.push_back(static_cast<unsigned char>(error));
+        }
+
+        void append(const BatchResult &other)
+        {
+            for(std::size_t i = 0; i < options_.size(); ++i) { options_[i]->append(*other.options_[i]); }
+            for(std::size_t i = 0; i < arguments_.size(); ++i) { arguments_[i]->append(*other.arguments_[i]); }
+            detail::appendBits(valid_, rows_, other.valid_, other.rows_);
+            errors_.insert(errors_.end(), other.errors_.begin(), other.errors_.end());
+            rows_ += other.rows_;
+        }
+
+        template<typename T>
+        const Column<T> &getColumn(const detail::ColumnBase *column) const MW_THROW(std::bad_cast)
+        {
+            if(column->uid_ != detail::TypeID<T>::getUID()) { throw std::bad_cast(); }
+            return *static_cast<const Column<T> *>(column);
+        }
+
+        static std::size_t indexOf(const std::vector<std::string> &list, const char *str)
+        {
+            return std::find(list.begin(), list.end(), str) - list.begin();
+        }
+    public:
+        BatchResult() : rows_(0) { }
+        ~BatchResult() { clear(); }
+
+        std::size_t getRows() const { return rows_; }
+        bool isValid(const std::size_t row) const { return (valid_[row / detail::WordBits] >> (row % detail::WordBits)) & 1; }
+        // bitmap of rows parsed successfully, bit i of word i / 64 is row i
+        const detail::Word *getValidBitmap() const { return valid_.empty() ? nullptr : &valid_[0]; }
+        ParseError getError(const std::size_t row) const { return static_cast<ParseError>(errors_[row]); }
+        // error codes of all rows, values are ParseError
+        const unsigned char *getErrors() const { return errors_.empty() ? nullptr : &errors_[0]; }
+
+        template<typename T>
+        const Column<T> &getOption(const int index) const { return getColumn<T>(options_.at(index + 1)); }
+
+        template<typename T>
+        const Column<T> &getOption(const char key) const { return getColumn<T>(options_.at(keys_.find(key))); }
+
+        template<typename T>
+        const Column<T> &getOption(const char *longkey) const { return getColumn<T>(options_.at(indexOf(longkeys_, longkey))); }
+
+        template<typename T>
+        const Column<T> &getArgument(const int index) const { return getColumn<T>(arguments_.at(index)); }
+
+        template<typename T>
+        const Column<T> &getArgument(const char *name) const { return getColumn<T>(arguments_.at(indexOf(names_, name))); }
+    };
+
+    class Parser final
+    {
+        template<typename T> friend class Flag;
+        typedef std::vector<detail::OptionBase *> OptionList;
+        typedef std::vector<detail::ArgumentBase *> ArgumentList;
+
+        /* constraint as declared, if trigger is not empty, it is dependency */
+        struct Constraint
+        {
+            std::vector<detail::KeyRef> trigger, keys;
+            std::size_t min, max;
+        };
+
+        /* constraint compiled into masks[index * 2](trigger) and masks[index * 2 + 1](keys) */
+        struct Rule
+        {
+            std::size_t min, max;
+            bool dependency;
+        };
+
+    private:
+        std::string description_, appName_;
+        // list keeps references returned by getUsage valid while other widths are added
+        std::list<std::pair<std::size_t, std::string> > usages_;
+        std::ostringstream errorMsg_;
+        OptionList options_, longKeys_;
+        detail::OptionBase *keyTable_[256];
+        ArgumentList arguments_;
+        detail::TokenIndex tokens_;
+        std::vector<Constraint> constraints_;
+        std::vector<Rule> rules_;
+        std::vector<detail::Word> masks_, required_, set_;
+        std::size_t words_;
+        ParseError error_;
+        bool dirty_, showErrors_, varg_, compiled_, silent_;
+
+        void remove(const detail::OptionBase *option)
+        {
+            options_.erase(std::remove(options_.begin(), options_.end(), option), options_.end());
+            dirty_ = true;
+            compiled_ = false;
+        }
+
+        template<typename T>
+        void clear(T &list)
+        {
+            for(typename T::const_iterator it = list.begin(); it != list.end(); ++it)
+            {
+                if(!(*it)->ref_) { delete *it; }
+            }
+
+            list.clear();
+        }
+
+        void init()
+        {
+            options_.push_back(
+                new Option<bool>(
+                    'h',
+                    "help",
+                    "display usage and information.",
+                    false
+                )
+            );
+        }
+
+        void setAppName(const std::string &str)
+        {
+            const std::string name(std::find_if(str.rbegin(), str.rend(), detail::Separator()).base(), str.end());
+            if(name == appName_) { return; }
+
+            // usage contains program name
+            appName_ = name;
+            dirty_ = true;
+        }
+
+        template<typename T, typename U>
+        typename T::value_type find(const T &begin, const T &end, const U& comp) const
+        {
+            const T it = std::find_if(begin, end, comp);
+            return it == end ? nullptr : *it;
+        }
+
+        detail::OptionBase *findByKey(const char key) const
+        {
+            if(key == 0)  { return nullptr; }
+            if(compiled_) { return keyTable_[static_cast<unsigned char>(key)]; }
+            return find(options_.begin(), options_.end(), detail::KeyComparator(key));
+        }
+
+        detail::OptionBase *findByLongKey(const char *key) const { return findByLongKey(key, std::strlen(key)); }
+        detail::OptionBase *findByLongKey(const char *key, const std::size_t size) const;
+        detail::ArgumentBase *findByName(const char *name) const { return find(arguments_.begin(), arguments_.end(), detail::NameComparator(name)); }
+
+        // value is given when specified like --key=value
+        bool parseArguments(ParseResult &r, detail::OptionBase *option, const char *key, const char *value = nullptr);
+
+        bool showHelp()
+        {
+            const detail::OptionBase *option = findByKey('h');
+            if(option && option->is<bool>() && static_cast<const Option<bool> *>(option)->getValue())
+            {
+                if(!silent_) { showUsage(); }
+                return true;
+            }
+
+            return false;
+        }
+
+        ParseResult fewArgError(const detail::OptionBase *option)
+        {
+            errorMsg_ << "argument should be specified for " << option->getDisplayName() << "\n";
+            error_ = ENUM_ELEM(ParseError, FewArguments);
+            return end();
+        }
+
+        ParseResult invalidTypeError(const detail::OptionBase *option)
+        {
+            errorMsg_ << "invalid type was specified for " << option->getDisplayName() << "\n";
+            error_ = ENUM_ELEM(ParseError, InvalidType);
+            return end();
+        }
+
+        // value rejected by converter, files are reported as unreadable rather than invalid
+        ParseResult valueError(const detail::OptionBase *option, const char *value)
+        {
+            if(option->is<MappedFile>() || option->is<std::vector<MappedFile> >())
+            {
+                errorMsg_ << "cannot open file: " << value << " (" << option->getDisplayName() << ")\n";
+                error_ = ENUM_ELEM(ParseError, Source);
+                return end();
+            }
+
+            return invalidTypeError(option);
+        }
+
+        ParseResult end()
+        {
+            if(showHelp()) { return ENUM_ELEM(ParseResult, HelpShown); }
+            const bool r = getErrorMessage().empty();
+            if(showErrors_ && !silent_ && !r)
+            {
+                std::cerr << getErrorMessage() << std::endl;
+            }
+
+            return r ? ENUM_ELEM(ParseResult, Success) : ENUM_ELEM(ParseResult, Failure);
+        }
+
+        static bool isSpace(const char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+        // snapshot record is { index, size, kind } followed by size bytes and NUL
+        enum RecordKind
+        {
+            Record_Text,
+            Record_Value
+        };
+
+        static void appendRecord(std::string &records, const std::size_t index, const char *value, const std::size_t size, const RecordKind kind = Record_Text)
+        {
+            const unsigned int header[3] = { static_cast<unsigned int>(index), static_cast<unsigned int>(size), static_cast<unsigned int>(kind) };
+            records.append(reinterpret_cast<const char *>(header), sizeof(header));
+            records.append(value, size);
+            records.push_back('\0');
+        }
+
+        // replace text records of options having binary form with values converted from the records
+        std::string convertRecords(const std::string &text) const;
+
+        unsigned long long getSchemaHash() const;
+
+        // assign value(s) from config file or environment, multiple argument values are separated by spaces
+        bool assignValue(
+            detail::OptionBase *option, const char *value, const std::size_t size,
+            const detail::Layer layer, std::string *records
+        );
+
+        bool parseConfig(const char *data, const std::size_t size, const char *path, std::string *records);
+
+        // converted value from snapshot, restored without text conversion by the same layering as assign
+        static bool restoreValue(detail::OptionBase *option, const char *data, const std::size_t size)
+        {
+            if(option->layer_ > detail::Layer_Config) { return true; }
+            if(option->layer_ < detail::Layer_Config || !option->isMultiArg())
+            {
+                option->reset();
+                option->layer_ = detail::Layer_Config;
+            }
+
+            return option->deserialize(data, size);
+        }
+
+        // apply pre-parsed snapshot, returns false if snapshot is missing or stale
+        bool loadSnapshot(const char *snapshot, const detail::FileView &file, const char *path, bool &result);
+
+        void saveSnapshot(const char *snapshot, const detail::FileView &file, const std::string &records) const;
+
+        std::size_t findIndex(const detail::KeyRef &ref) const MW_THROW(std::runtime_error)
+        {
+            const detail::OptionBase *option = ref.longkey ? findByLongKey(ref.longkey) : findByKey(ref.key);
+            if(!option) { throw std::runtime_error("unknown key is specified in constraint."); }
+            return std::find(options_.begin(), options_.end(), option) - options_.begin();
+        }
+
+        void compileMask(detail::Word *mask, const std::vector<detail::KeyRef> &keys) const;
+
+        // compile required options and constraints into bitmasks
+        void compile();
+
+        void writeOption(const std::size_t index)
+        {
+            const detail::OptionBase *option = options_[index];
+            errorMsg_ << option->getDisplayName();
+        }
+
+        void writeOptions(const detail::Word *mask);
+
+        // check required options and constraints, returns false if violated
+        bool validate();
+
+        // dispatch classified tokens
+        ParseResult parseTokens();
+
+        // reset all values and errors for next parse
+        void clearState()
+        {
+            for(OptionList::const_iterator it = options_.begin(); it != options_.end(); ++it) { (*it)->reset(); }
+            for(ArgumentList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it) { (*it)->reset(); }
+            errorMsg_.str("");
+            errorMsg_.clear();
+            error_ = ENUM_ELEM(ParseError, None);
+        }
+
+        // copy options, arguments and constraints of other parser
+        void copySchema(const Parser &other);
+
+        void initBatch(BatchResult &result) const;
+
+        // split command line by spaces, quotes and backslash escape are handled like shell
+        static void tokenize(const std::string &line, std::string &buffer, std::vector<std::size_t> &offsets);
+
+        void parseRow(const std::string &line, BatchResult &result, std::string &buffer, std::vector<std::size_t> &offsets, std::vector<const char *> &argv);
+
+        void parseRows(const std::string *begin, const std::string *end, BatchResult &result);
+
+#ifdef MW_POSIX
+        static std::size_t getTerminalWidth(const int fd);
+#endif
+
+        void buildUsage(std::string &str, const std::size_t width) const;
+
+        Parser &addConstraint(const Keys *trigger, const Keys &keys, const std::size_t min, const std::size_t max);
+
+        template<typename T, typename U>
+        T getValue(const detail::Base *base) const MW_THROW(std::bad_cast)
+        {
+            if(!base->is<T>()) { throw std::bad_cast(); }
+            return std::move(static_cast<const U *>(base)->getValue());
+        }
+
+        Parser &add(detail::OptionBase *option) MW_THROW(std::runtime_error);
+
+        Parser &add(detail::ArgumentBase *arg) MW_THROW(std::runtime_error);
+    public:
+        Parser()
+        : words_(0), error_(ENUM_ELEM(ParseError, None)), dirty_(true), showErrors_(false), varg_(false), compiled_(false), silent_(false)
+        { init(); }
+
+        Parser(const char *desc)
+        : description_(desc), words_(0), error_(ENUM_ELEM(ParseError, None)), dirty_(true), showErrors_(true), varg_(false), compiled_(false), silent_(false)
+        { init(); }
+
+        Parser(const char *desc, const bool showErrors)
+        : description_(desc), words_(0), error_(ENUM_ELEM(ParseError, None)), dirty_(true), showErrors_(showErrors), varg_(false), compiled_(false), silent_(false)
+        { init(); }
+
+        ~Parser()
+        {
+            clear(options_);
+            clear(arguments_);
+        }
+
+        ParseResult parse(const int argc, const char *argv[])
+        {
+            tokens_.assign(argc, argv);
+            setAppName(argv[0]);
+            return parseTokens();
+        }
+
+        /*
+         * parse NUL separated command line like /proc/self/cmdline, the first token is program name.
+         * tokens are read in place without copying.
+         */
+        ParseResult parse(const char *buffer, const std::size_t size)
+        {
+            tokens_.assign(buffer, size);
+            setAppName(tokens_.empty() ? "" : tokens_.current());
+            return parseTokens();
+        }
+
+#ifdef MW_POSIX
+        /* parse command line of current process from /proc/self/cmdline, can be used before main */
+        ParseResult parseCommandLine();
+#endif
+
+        /*
+         * parse command lines(one line is one command line including program name) and store values in columns.
+         * values set by parse, loadConfig and loadEnvironment are cleared. if threads is greater than 1, lines
+         * are split across threads(C++11).
+         */
+        void parseBatch(std::istream &is, BatchResult &result, const unsigned int threads = 1);
+
+        /*
+         * load options from config file, values are overridden by environment and command line.
+         * if snapshot is specified, pre-parsed values are cached in it and reused while
+         * size, modified time of the config file and option set are unchanged.
+         */
+        bool loadConfig(const char *path, const char *snapshot = nullptr);
+
+        /* load options from environment variables named prefix + upper case long key("foo-bar" -> PREFIX_FOO_BAR) */
+        bool loadEnvironment(const char *prefix);
+
+        /* constraints, checked after parsing */
+        // at most one of keys can be specified
+        Parser &exclusive(const Keys &keys) { return addConstraint(nullptr, keys, 0, 1); }
+
+        // at least one of keys should be specified
+        Parser &atLeastOne(const Keys &keys) { return addConstraint(nullptr, keys, 1, keys.keys_.size()); }
+
+        // number of specified keys should be in [min, max]
+        Parser &count(const Keys &keys, const std::size_t min, const std::size_t max) { return addConstraint(nullptr, keys, min, max); }
+
+        // if any of options is specified, all of required should be specified
+        Parser &depends(const Keys &options, const Keys &required) { return addConstraint(&options, required, 0, 0); }
+
+        /* usage without wrapping */
+        const std::string &getUsage() { return getUsage(0); }
+
+        /* usage wrapped at width, built once for each width. the reference is valid until options or program name are changed */
+        const std::string &getUsage(const std::size_t width);
+
+        void showUsage();
+
+#ifdef MW_POSIX
+        /* write usage wrapped at terminal width(or $COLUMNS) to fd by one writev */
+        void showUsage(const int fd);
+#endif
+        std::string getErrorMessage() const { return errorMsg_.str(); }
+        ParseError getError() const { return error_; }
+        std::string getAppName() const { return appName_; }
+
+        // same as the arguments of constructor, for parsers created without them such as getGlobalParser()
+        void setDescription(const char *desc) { description_ = desc; dirty_ = true; }
+        void setShowErrors(const bool showErrors) { showErrors_ = showErrors; }
+
+        template<typename T>
+        T getOption(const int index) const { return getValue<T, Option<T> >(options_.at(index + 1)); }
+
+        template<typename T>
+        T getOption(const char key) const { return getValue<T, Option<T> >(findByKey(key)); }
+
+        template<typename T>
+        T getOption(const char *longkey) const { return getValue<T, Option<T> >(findByLongKey(longkey)); }
+
+        template<typename T>
+        T getArgument(const int index) const { return getValue<T, Argument<T> >(arguments_.at(index)); }
+
+        template<typename T>
+        T getArgument(const char *name) const { return getValue<T, Argument<T> >(findByName(name)); }
+
+#ifdef MW_CPP11
+        template<
+            typename T,
+            typename... Args,
+            typename = typename std::enable_if<(sizeof...(Args) > 0)>::type
+        >
+        Parser &add(T &&t, Args &&...args) MW_THROW(std::runtime_error)
+        {
+            add(std::forward<T>(t));
+            return add(std::forward<Args>(args)...);
+        }
+#endif
+
+        /* options */
+        template<typename T>
+        Parser &add(const Option<T> &option) { return add(new Option<T>(option)); }
+
+        template<typename T>
+        Parser &add(Option<T> &option)
+        {
+            option.ref_ = true;
+            return add(&option);
+        }
+
+        /* arguments */
+        template<typename T>
+        Parser &add(const Argument<T> &arg) { return add(new Argument<T>(arg)); }
+
+        template<typename T>
+        Parser &add(Argument<T> &arg)
+        {
+            arg.ref_ = true;
+            return add(&arg);
+        }
+    };
+
+    namespace detail
+    {
+        class FlagBase
+        {
+        public:
+            virtual ~FlagBase() { }
+            virtual const Label &getLongKey() const = 0;
+            virtual bool set(const char *value) = 0;
+            virtual void publish() = 0;
+        };
+
+        /* parser and flags shared by all translation units, created on first use */
+        struct GlobalRegistry final
+        {
+            Parser parser;
+            std::vector<FlagBase *> flags;
+        };
+
+        MW_INLINE GlobalRegistry &getGlobalRegistry();
+
+#ifdef MW_CPP11
+        /* value of trivially copyable type which std::atomic handles lock free without libatomic */
+        template<typename T>
+        struct IsAtomicValue final
+        {
+            static const bool value =
+                std::is_trivially_copyable<T>::value && sizeof(T) <= sizeof(long long) && (sizeof(T) & (sizeof(T) - 1)) == 0;
+        };
+
+        /*
+         * other values are read through an atomic pointer. replaced values are kept until the flag is destroyed,
+         * so a reference returned by load stays valid without lock or reference count. store is called under GlobalLock
+         */
+        template<typename T, bool Atomic = IsAtomicValue<T>::value>
+        class FlagStorage final
+        {
+        public:
+            typedef const T &value_type;
+        private:
+            std::atomic<const T *> value_;
+            std::vector<std::unique_ptr<const T> > values_;
+        public:
+            FlagStorage() : value_(nullptr) { }
+
+            value_type load() const { return *value_.load(std::memory_order_acquire); }
+            void store(const T &value)
+            {
+                values_.push_back(std::unique_ptr<const T>(new T(value)));
+                value_.store(values_.back().get(), std::memory_order_release);
+            }
+        };
+
+        template<typename T>
+        class FlagStorage<T, true> final
+        {
+        public:
+            typedef T value_type;
+        private:
+            std::atomic<T> value_;
+        public:
+            FlagStorage() : value_(T()) { }
+
+            value_type load() const { return value_.load(std::memory_order_acquire); }
+            void store(const T &value) { value_.store(value, std::memory_order_release); }
+        };
+#else
+        /* flags are not updated concurrently without threads */
+        template<typename T>
+        class FlagStorage final
+        {
+        public:
+            typedef const T &value_type;
+        private:
+            T value_;
+        public:
+            FlagStorage() : value_(T()) { }
+
+            value_type load() const { return value_; }
+            void store(const T &value) { value_ = value; }
+        };
+#endif
+    }
+
+    /*
+     * option registered to the global parser on construction.
+     * define flags at namespace scope in any translation unit and call clip::parseGlobal in main.
+     * values are converted by the same rule as command line.
+     * get() of small trivially copyable types is one atomic load of the value itself. other types
+     * return const T & by one atomic load of a pointer, and values replaced by set() are kept until
+     * the flag is destroyed, so set() is meant for values tuned occasionally.
+     */
+    template<typename T>
+    class Flag final : public detail::FlagBase
+    {
+    public:
+        typedef typename detail::FlagStorage<T>::value_type value_type;
+    private:
+        Option<T> option_;
+        detail::FlagStorage<T> value_;
+
+        Flag(const Flag &);
+        Flag &operator=(const Flag &);
+
+        void init()
+        {
+            value_.store(option_.getValue());
+            detail::GlobalRegistry &registry = detail::getGlobalRegistry();
+            registry.parser.add(option_);
+            registry.flags.push_back(this);
+        }
+    public:
+        template<typename A, typename B>
+        Flag(const char key, const A &longkey, const B &desc)
+        : option_(key, longkey, desc)
+        { init(); }
+
+        template<typename A, typename B, typename C>
+        Flag(const char key, const A &longkey, const B &name, const C &desc)
+        : option_(key, longkey, name, desc)
+        { init(); }
+
+        template<typename A, typename B, typename C, typename D>
+        Flag(const char key, const A &longkey, const B &name, const C &desc, const D &defaultValue)
+        : option_(key, longkey, name, desc, defaultValue)
+        { init(); }
+
+        ~Flag()
+        {
+            detail::GlobalRegistry &registry = detail::getGlobalRegistry();
+            registry.parser.remove(&option_);
+            registry.flags.erase(std::remove(registry.flags.begin(), registry.flags.end(), this), registry.flags.end());
+        }
+
+        value_type get() const { return value_.load(); }
+
+        value_type operator*() const { return get(); }
+        const T *operator->() const { return &get(); }
+
+        const detail::Label &getLongKey() const override { return option_.getLongKey(); }
+
+        /* update value at runtime, safe to call while other threads read this flag */
+        bool set(const char *value) override
+        {
+            detail::GlobalRegistry &registry = detail::getGlobalRegistry();
+            detail::GlobalLock lock;
+            Option<T> option(option_);
+            option.reset();
+            if(!registry.parser.assignValue(&option, value, std::strlen(value), detail::Layer_CommandLine, nullptr)) { return false; }
+
+            value_.store(option.getValue());
+            return true;
+        }
+
+        void publish() override
+        {
+            detail::GlobalLock lock;
+            value_.store(option_.getValue());
+        }
+    };
+
+    /* global parser to set description and showing errors, load config files or show usage before parseGlobal */
+    inline Parser &getGlobalParser() { return detail::getGlobalRegistry().parser; }
+
+    /* parse command line for all flags, values are published only when parsing succeeded */
+    inline ParseResult parseGlobal(const int argc, const char *argv[])
+    {
+        detail::GlobalRegistry &registry = detail::getGlobalRegistry();
+        const ParseResult r = registry.parser.parse(argc, argv);
+        if(r == ENUM_ELEM(ParseResult, Success))
+        {
+            for(std::size_t i = 0; i < registry.flags.size(); ++i) { registry.flags[i]->publish(); }
+        }
+
+        return r;
+    }
+
+    /* update flag named longkey, flags should not be created or destroyed concurrently */
+    inline bool setGlobal(const char *longkey, const char *value)
+    {
+        const detail::GlobalRegistry &registry = detail::getGlobalRegistry();
+        for(std::size_t i = 0; i < registry.flags.size(); ++i)
+        {
+            if(std::strcmp(registry.flags[i]->getLongKey().c_str(), longkey) == 0) { return registry.flags[i]->set(value); }
+        }
+
+        return false;
+    }
+}
+
+/*
+ * out-of-line definitions, define CLIP_EXTERN_TEMPLATES and link clip.cpp to compile them only once.
+ * headers used only by them are included here.
+ */
+#if !defined(CLIP_EXTERN_TEMPLATES) || defined(CLIP_INSTANTIATE_TEMPLATES)
+#   include <fstream>
+
+#ifdef MW_CPP11
+#   include <functional>
+#   include <mutex>
+#   include <thread>
+#endif
+
+#ifdef MW_POSIX
+#   include <sys/ioctl.h>
+#   include <sys/uio.h>
+#endif
+
+namespace clip
+{
+    namespace detail
+    {
+        MW_INLINE GlobalRegistry &getGlobalRegistry()
+        {
+            static GlobalRegistry registry;
+            return registry;
+        }
+
+#ifdef MW_CPP11
+        MW_INLINE std::mutex &getGlobalMutex()
+        {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        MW_INLINE void lockGlobal() { getGlobalMutex().lock(); }
+        MW_INLINE void unlockGlobal() { getGlobalMutex().unlock(); }
+#else
+        MW_INLINE void lockGlobal() { }
+        MW_INLINE void unlockGlobal() { }
+#endif
+    }
+
+    MW_INLINE detail::OptionBase *Parser::findByLongKey(const char *key, const std::size_t size) const
+    {
+        if(!compiled_) { return find(options_.begin(), options_.end(), detail::LongKeyComparator(key, size)); }
+
+        // binary search on sorted long keys
+        std::size_t first = 0, last = longKeys_.size();
+        while(first < last)
+        {
+            const std::size_t mid = first + (last - first) / 2;
+            const detail::Label &k = longKeys_[mid]->getLongKey();
+            const int r = detail::LongKeySort::compare(k.c_str(), k.size(), key, size);
+            if(r == 0)     { return longKeys_[mid]; }
+            else if(r < 0) { first = mid + 1; }
+            else           { last = mid; }
+        }
+
+        return nullptr;
+    }
+
+    MW_INLINE bool Parser::parseArguments(ParseResult &r, detail::OptionBase *option, const char *key, const char *value)
+    {
+        if(!option)
+        {
+            errorMsg_ << "invalid argument name specified: " << key << "\n";
+            error_ = ENUM_ELEM(ParseError, InvalidName);
+            r = end();
+            return true;
+        }
+
+        if(option->isMultiArg())
+        {
+            if(value && !option->assign(value, detail::Layer_CommandLine))
+            {
+                r = valueError(option, value);
+                return true;
+            }
+
+            const std::size_t n = tokens_.countValues();
+            option->reserve(n);
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                tokens_.advance();
+                if(!option->assign(tokens_.current(), detail::Layer_CommandLine))
+                {
+                    r = valueError(option, tokens_.current());
+                    return true;
+                }
+            }
+        }
+        else
+        {
+            if(option->is<bool>())
+            {
+                if(!option->assign(value, detail::Layer_CommandLine))
+                {
+                    r = invalidTypeError(option);
+                    return true;
+                }
+
+                return false;
+            }
+
+            if(value || tokens_.advance())
+            {
+                if(!value && tokens_.type() == detail::TokenType_Value) { value = tokens_.current(); }
+                if(value)
+                {
+                    // specified twice
+                    if(option->isSet() && option->layer_ == detail::Layer_CommandLine)
+                    {
+                        r = fewArgError(option);
+                        return true;
+                    }
+
+                    if(!option->assign(value, detail::Layer_CommandLine))
+                    {
+                        r = valueError(option, value);
+                        return true;
+                    }
+                }
+            }
+            else
+            {
+                r = fewArgError(option);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    MW_INLINE std::string Parser::convertRecords(const std::string &text) const
+    {
+        // values of this file only, earlier files and other layers are not included
+        std::vector<detail::OptionBase *> values(options_.size(), static_cast<detail::OptionBase *>(nullptr));
+        unsigned int h[3];
+        bool r = true;
+        for(const char *p = text.data(), *end = p + text.size(); r && p != end; p += h[1] + 1)
+        {
+            std::memcpy(h, p, sizeof(h));
+            p += sizeof(h);
+
+            detail::OptionBase *&value = values[h[0]];
+            if(!value)
+            {
+                value = static_cast<detail::OptionBase *>(options_[h[0]]->clone());
+                value->reset();
+            }
+            r = value->assign(p, detail::Layer_Config);
+        }
+
+        std::string records, data;
+        std::vector<bool> converted(options_.size(), false);
+        for(std::size_t i = 0; i < options_.size(); ++i)
+        {
+            data.clear();
+            if(r && values[i] && values[i]->serialize(data))
+            {
+                appendRecord(records, i, data.data(), data.size(), Record_Value);
+                converted[i] = true;
+            }
+            delete values[i];
+        }
+
+        for(const char *p = text.data(), *end = p + text.size(); p != end; p += h[1] + 1)
+        {
+            std::memcpy(h, p, sizeof(h));
+            p += sizeof(h);
+            if(!converted[h[0]]) { appendRecord(records, h[0], p, h[1]); }
+        }
+
+        return records;
+    }
+
+    MW_INLINE unsigned long long Parser::getSchemaHash() const
+    {
+        unsigned long long h = detail::hash("clip-snapshot-3", 15);
+        for(OptionList::const_iterator it = options_.begin(); it != options_.end(); ++it)
+        {
+            const detail::OptionBase *option = *it;
+            const char attr[2] = { option->getKey(), option->isMultiArg() ? '*' : '1' };
+            const char *type = typeid(*option).name();
+            h = detail::hash(attr, sizeof(attr), h);
+            h = detail::hash(option->getLongKey().c_str(), option->getLongKey().size() + 1, h);
+            h = detail::hash(type, std::strlen(type) + 1, h);
+        }
+
+        return h;
+    }
+
+    MW_INLINE bool Parser::assignValue(
+        detail::OptionBase *option, const char *value, const std::size_t size,
+        const detail::Layer layer, std::string *records
+    )
+    {
+        const std::size_t index = std::find(options_.begin(), options_.end(), option) - options_.begin();
+        if(!value)
+        {
+            if(!option->is<bool>()) { return false; }
+            if(records) { appendRecord(*records, index, "1", 1); }
+            return option->assign(nullptr, layer);
+        }
+
+        std::string token;
+        const char *p = value, *end = value + size;
+        while(p != end)
+        {
+            if(option->isMultiArg())
+            {
+                while(p != end && isSpace(*p)) { ++p; }
+                if(p == end) { break; }
+                const char *first = p;
+                while(p != end && !isSpace(*p)) { ++p; }
+                token.assign(first, p);
+            }
+            else
+            {
+                token.assign(p, end);
+                p = end;
+            }
+
+            if(records) { appendRecord(*records, index, token.data(), token.size()); }
+            if(!option->assign(token.c_str(), layer)) { return false; }
+        }
+
+        return true;
+    }
+
+    MW_INLINE bool Parser::parseConfig(const char *data, const std::size_t size, const char *path, std::string *records)
+    {
+        const char *p = data, *end = data + size;
+        std::string key;
+        for(std::size_t line = 1; p < end; ++line)
+        {
+            const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            if(!eol) { eol = end; }
+
+            // trim
+            const char *first = p, *last = eol;
+            p = eol + 1;
+            while(first != last && isSpace(*first)) { ++first; }
+            while(first != last && isSpace(*(last - 1))) { --last; }
+            if(first == last || *first == '#' || *first == ';') { continue; }
+
+            const char *eq = std::find(first, last, '=');
+            const char *keyEnd = eq;
+            while(keyEnd != first && isSpace(*(keyEnd - 1))) { --keyEnd; }
+            key.assign(first, keyEnd);
+
+            detail::OptionBase *option = findByLongKey(key.c_str());
+            if(!option)
+            {
+                errorMsg_ << "invalid argument name specified: " << key << " (" << path << ":" << line << ")\n";
+                error_ = ENUM_ELEM(ParseError, InvalidName);
+                return false;
+            }
+
+            const char *value = nullptr;
+            if(eq != last)
+            {
+                value = eq + 1;
+                while(value != last && isSpace(*value)) { ++value; }
+                if(last - value >= 2 && (*value == '"' || *value == '\'') && *(last - 1) == *value)
+                {
+                    ++value;
+                    --last;
+                }
+            }
+
+            if(!assignValue(option, value, last - value, detail::Layer_Config, records))
+            {
+                errorMsg_ << "invalid type was specified for " << option->getDisplayName() << " (" << path << ":" << line << ")\n";
+                error_ = ENUM_ELEM(ParseError, InvalidType);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    MW_INLINE bool Parser::loadSnapshot(const char *snapshot, const detail::FileView &file, const char *path, bool &result)
+    {
+        detail::FileView view;
+        if(!view.open(snapshot) || view.size() < sizeof(detail::SnapshotHeader)) { return false; }
+
+        detail::SnapshotHeader header;
+        std::memcpy(&header, view.data(), sizeof(header));
+        if(
+            std::memcmp(header.magic, "CLIPSNAP", sizeof(header.magic)) != 0 ||
+            header.fileSize != file.size() || header.modified != file.getModified() ||
+            header.schema != getSchemaHash()
+        )
+        {
+            return false;
+        }
+
+        // validate all records before touching any option
+        const char *begin = view.data() + sizeof(header), *end = view.data() + view.size();
+        unsigned int h[3];
+        const char *p = begin;
+        while(p != end)
+        {
+            if(static_cast<std::size_t>(end - p) < sizeof(h)) { return false; }
+            std::memcpy(h, p, sizeof(h));
+            p += sizeof(h);
+            if(h[0] >= options_.size() || h[2] > Record_Value || static_cast<std::size_t>(end - p) <= h[1] || p[h[1]] != '\0') { return false; }
+            p += h[1] + 1;
+        }
+
+        result = true;
+        for(p = begin; p != end; p += h[1] + 1)
+        {
+            std::memcpy(h, p, sizeof(h));
+            p += sizeof(h);
+            detail::OptionBase *option = options_[h[0]];
+            const bool r = h[2] == Record_Value ? restoreValue(option, p, h[1]) : option->assign(p, detail::Layer_Config);
+            if(!r)
+            {
+                errorMsg_ << "invalid type was specified for " << option->getDisplayName() << " (" << path << ")\n";
+                error_ = ENUM_ELEM(ParseError, InvalidType);
+                result = false;
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    MW_INLINE void Parser::saveSnapshot(const char *snapshot, const detail::FileView &file, const std::string &records) const
+    {
+        detail::SnapshotHeader header;
+        std::memcpy(header.magic, "CLIPSNAP", sizeof(header.magic));
+        header.fileSize = file.size();
+        header.modified = file.getModified();
+        header.schema = getSchemaHash();
+
+        // write to temporary file and rename, so that readers never see partial snapshot
+        const std::string tmp = std::string(snapshot) + ".tmp";
+        {
+            std::ofstream ofs(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if(!ofs) { return; }
+            ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            ofs.write(records.data(), records.size());
+            if(!ofs) { std::remove(tmp.c_str()); return; }
+        }
+
+        if(std::rename(tmp.c_str(), snapshot) != 0) { std::remove(tmp.c_str()); }
+    }
+
+    MW_INLINE void Parser::compileMask(detail::Word *mask, const std::vector<detail::KeyRef> &keys) const
+    {
+        for(std::vector<detail::KeyRef>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+        {
+            const std::size_t index = findIndex(*it);
+            mask[index / detail::WordBits] |= detail::Word(1) << (index % detail::WordBits);
+        }
+    }
+
+    MW_INLINE void Parser::compile()
+    {
+        // lookup tables for dispatch
+        std::fill(keyTable_, keyTable_ + sizeof(keyTable_) / sizeof(*keyTable_), static_cast<detail::OptionBase *>(nullptr));
+        for(OptionList::const_iterator it = options_.begin(); it != options_.end(); ++it)
+        {
+            keyTable_[static_cast<unsigned char>((*it)->getKey())] = *it;
+        }
+
+        longKeys_ = options_;
+        std::sort(longKeys_.begin(), longKeys_.end(), detail::LongKeySort());
+
+        words_ = (options_.size() + detail::WordBits - 1) / detail::WordBits;
+        required_.assign(words_, 0);
+        set_.assign(words_, 0);
+        masks_.assign(constraints_.size() * 2 * words_, 0);
+        rules_.clear();
+
+        for(std::size_t i = 0; i < options_.size(); ++i)
+        {
+            if(!options_[i]->isOptional())
+            {
+                required_[i / detail::WordBits] |= detail::Word(1) << (i % detail::WordBits);
+            }
+        }
+
+        for(std::size_t i = 0; i < constraints_.size(); ++i)
+        {
+            const Constraint &c = constraints_[i];
+            compileMask(&masks_[i * 2 * words_], c.trigger);
+            compileMask(&masks_[(i * 2 + 1) * words_], c.keys);
+
+            const Rule rule = { c.min, c.max, !c.trigger.empty() };
+            rules_.push_back(rule);
+        }
+
+        compiled_ = true;
+    }
+
+    MW_INLINE void Parser::writeOptions(const detail::Word *mask)
+    {
+        const char *sep = "";
+        for(std::size_t w = 0; w < words_; ++w)
+        {
+            for(detail::Word bits = mask[w]; bits; bits &= bits - 1)
+            {
+                errorMsg_ << sep;
+                writeOption(w * detail::WordBits + detail::lowestBit(bits));
+                sep = ", ";
+            }
+        }
+    }
+
+    MW_INLINE bool Parser::validate()
+    {
+        if(!compiled_) { compile(); }
+
+        std::fill(set_.begin(), set_.end(), 0);
+        for(std::size_t i = 0; i < options_.size(); ++i)
+        {
+            set_[i / detail::WordBits] |= detail::Word(options_[i]->isSet()) << (i % detail::WordBits);
+        }
+
+        for(std::size_t w = 0; w < words_; ++w)
+        {
+            const detail::Word missing = required_[w] & ~set_[w];
+            if(missing)
+            {
+                writeOption(w * detail::WordBits + detail::lowestBit(missing));
+                errorMsg_ << " should be specified.\n";
+                error_ = ENUM_ELEM(ParseError, Missing);
+                return false;
+            }
+        }
+
+        std::vector<detail::Word> hit(words_);
+        for(std::size_t i = 0; i < rules_.size(); ++i)
+        {
+            const Rule &rule = rules_[i];
+            const detail::Word *trigger = &masks_[i * 2 * words_], *keys = trigger + words_;
+
+            if(rule.dependency)
+            {
+                bool triggered = false, missing = false;
+                for(std::size_t w = 0; w < words_; ++w)
+                {
+                    triggered |= (trigger[w] & set_[w]) != 0;
+                    hit[w] = keys[w] & ~set_[w];
+                    missing |= hit[w] != 0;
+                }
+
+                if(triggered && missing)
+                {
+                    for(std::size_t w = 0; w < words_; ++w) { hit[w] = trigger[w] & set_[w]; }
+                    writeOptions(&hit[0]);
+                    errorMsg_ << " requires ";
+                    for(std::size_t w = 0; w < words_; ++w) { hit[w] = keys[w] & ~set_[w]; }
+                    writeOptions(&hit[0]);
+                    errorMsg_ << ".\n";
+                    error_ = ENUM_ELEM(ParseError, Constraint);
+                    return false;
+                }
+            }
+            else
+            {
+                std::size_t count = 0;
+                for(std::size_t w = 0; w < words_; ++w) { count += detail::popcount(keys[w] & set_[w]); }
+                if(count < rule.min)
+                {
+                    errorMsg_ << "at least " << rule.min << " of ";
+                    writeOptions(keys);
+                    errorMsg_ << " should be specified.\n";
+                    error_ = ENUM_ELEM(ParseError, Constraint);
+                    return false;
+                }
+
+                if(count > rule.max)
+                {
+                    for(std::size_t w = 0; w < words_; ++w) { hit[w] = keys[w] & set_[w]; }
+                    writeOptions(&hit[0]);
+                    if(rule.max == 1) { errorMsg_ << " cannot be specified together.\n"; }
+                    else              { errorMsg_ << " are specified, but at most " << rule.max << " can be specified.\n"; }
+                    error_ = ENUM_ELEM(ParseError, Constraint);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    MW_INLINE ParseResult Parser::parseTokens()
+    {
+        if(!compiled_) { compile(); }
+
+        ArgumentList::iterator it = arguments_.begin();
+        while(tokens_.advance())
+        {
+            const char *arg = tokens_.current();
+            switch(tokens_.type())
+            {
+                case detail::TokenType_Value:
+                    {
+                        if(arguments_.empty()) { break; }
+
+                        const bool next = it != arguments_.end();
+                        detail::ArgumentBase *a = next ? *it++ : arguments_.back();
+                        if(it != arguments_.end() || !a->isMultiArg())
                         {
-                            oss << "(optional) ";
+                            if(next) { a->setValue(arg); }
+                            break;
                         }
 
-                        oss << option->getDesc() << "\n";
+                        // last variadic argument takes following values at once
+                        const std::size_t n = tokens_.countValues();
+                        a->reserve(n + 1);
+                        a->setValue(arg);
+                        for(std::size_t i = 0; i < n; ++i)
+                        {
+                            tokens_.advance();
+                            a->setValue(tokens_.current());
+                        }
                     }
-                }
+                    break;
+                case detail::TokenType_Key:
+                    {
+                        const char *keys = arg + 1;
+                        if(keys[0] && !keys[1])
+                        {
+                            // argument mode
+                            ParseResult r;
+                            char kn[2] = { *keys, 0 };
+                            if(parseArguments(r, findByKey(*keys), kn))
+                            {
+                                return r;
+                            }
+                        }
+                        else
+                        {
+                            // switch mode
+                            while(*keys)
+                            {
+                                detail::OptionBase *option = findByKey(*keys);
+                                if(!option)
+                                {
+                                    errorMsg_ << "invalid argument name specified: -" << *keys << "\n";
+                                    error_ = ENUM_ELEM(ParseError, InvalidName);
+                                    return end();
+                                }
+
+                                if(option->is<bool>())
+                                {
+                                    if(!option->assign(nullptr, detail::Layer_CommandLine))
+                                    {
+                                        return invalidTypeError(option);
+                                    }
+                                }
+                                else
+                                {
+                                    return invalidTypeError(option);
+                                }
+
+                                ++keys;
+                            }
+                        }
 
-                oss << "\n" << description_ << std::endl;
-                usage_ = oss.str();
-                dirty_ = false;
+                    }
+                    break;
+                case detail::TokenType_LongKey:
+                    {
+                        ParseResult r;
+                        const char *eq = std::strchr(arg + 2, '=');
+                        const std::size_t size = eq ? eq - arg - 2 : std::strlen(arg + 2);
+                        if(parseArguments(r, findByLongKey(arg + 2, size), arg, eq ? eq + 1 : nullptr))
+                        {
+                            return r;
+                        }
+                    }
+                    break;
             }
+        }
 
-            return usage_;
+        if(!validate()) { return end(); }
+
+        for(ArgumentList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it)
+        {
+            const detail::ArgumentBase *arg = *it;
+            if(!arg->isSet() && !arg->isOptional())
+            {
+                errorMsg_ << arg->getName() << " should be specified.\n";
+                error_ = ENUM_ELEM(ParseError, Missing);
+                return end();
+            }
         }
 
-        void showUsage() { std::cout << getUsage() << std::endl; }
-        std::string getErrorMessage() const { return errorMsg_.str(); }
-        std::string getAppName() const { return appName_; }
+        return end();
+    }
 
-        template<typename T>
-        T getOption(const int index) const { return getValue<T, Option<T> >(options_.at(index + 1)); }
+    MW_INLINE void Parser::copySchema(const Parser &other)
+    {
+        clear(options_);
+        clear(arguments_);
+        for(OptionList::const_iterator it = other.options_.begin(); it != other.options_.end(); ++it)
+        {
+            detail::OptionBase *option = static_cast<detail::OptionBase *>((*it)->clone());
+            option->ref_ = false;
+            options_.push_back(option);
+        }
 
-        template<typename T>
-        T getOption(const char key) const { return getValue<T, Option<T> >(findByKey(key)); }
+        for(ArgumentList::const_iterator it = other.arguments_.begin(); it != other.arguments_.end(); ++it)
+        {
+            detail::ArgumentBase *arg = static_cast<detail::ArgumentBase *>((*it)->clone());
+            arg->ref_ = false;
+            arguments_.push_back(arg);
+        }
 
-        template<typename T>
-        T getOption(const char *longkey) const { return getValue<T, Option<T> >(findByLongKey(longkey)); }
+        constraints_ = other.constraints_;
+        varg_ = other.varg_;
+        dirty_ = true;
+        compiled_ = false;
+    }
 
-        template<typename T>
-        T getArgument(const int index) const { return getValue<T, Argument<T> >(arguments_.at(index)); }
+    MW_INLINE void Parser::initBatch(BatchResult &result) const
+    {
+        result.clear();
+        for(OptionList::const_iterator it = options_.begin(); it != options_.end(); ++it)
+        {
+            result.options_.push_back((*it)->createColumn());
+            result.keys_.push_back((*it)->getKey());
+            result.longkeys_.push_back((*it)->getLongKey().str());
+        }
 
-        template<typename T>
-        T getArgument(const char *name) const { return getValue<T, Argument<T> >(findByName(name)); }
+        for(ArgumentList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it)
+        {
+            result.arguments_.push_back((*it)->createColumn());
+            result.names_.push_back((*it)->getName().str());
+        }
+    }
+
+    MW_INLINE void Parser::tokenize(const std::string &line, std::string &buffer, std::vector<std::size_t> &offsets)
+    {
+        buffer.clear();
+        offsets.clear();
+        char quote = 0;
+        bool token = false;
+        for(std::string::const_iterator c = line.begin(); c != line.end(); ++c)
+        {
+            if(!quote && isSpace(*c))
+            {
+                if(token) { buffer.push_back('\0'); token = false; }
+                continue;
+            }
+
+            if(!token)
+            {
+                offsets.push_back(buffer.size());
+                token = true;
+            }
+
+            if(quote && *c == quote)                        { quote = 0; }
+            else if(!quote && (*c == '"' || *c == '\''))    { quote = *c; }
+            else if(*c == '\\' && quote != '\'' && c + 1 != line.end()) { buffer.push_back(*++c); }
+            else                                            { buffer.push_back(*c); }
+        }
+
+        if(token) { buffer.push_back('\0'); }
+    }
+
+    MW_INLINE void Parser::parseRow(const std::string &line, BatchResult &result, std::string &buffer, std::vector<std::size_t> &offsets, std::vector<const char *> &argv)
+    {
+        tokenize(line, buffer, offsets);
+        argv.clear();
+        for(std::vector<std::size_t>::const_iterator it = offsets.begin(); it != offsets.end(); ++it)
+        {
+            argv.push_back(buffer.data() + *it);
+        }
+
+        clearState();
+        ParseError error = ENUM_ELEM(ParseError, None);
+        if(!argv.empty())
+        {
+            tokens_.assign(static_cast<int>(argv.size()), &argv[0]);
+            const ParseResult r = parseTokens();
+            if(r == ENUM_ELEM(ParseResult, HelpShown))    { error = ENUM_ELEM(ParseError, HelpRequested); }
+            else if(r == ENUM_ELEM(ParseResult, Failure)) { error = error_; }
+        }
+        else
+        {
+            error = validate() ? ENUM_ELEM(ParseError, None) : error_;
+        }
+
+        for(std::size_t i = 0; i < options_.size(); ++i) { options_[i]->storeValue(*result.options_[i]); }
+        for(std::size_t i = 0; i < arguments_.size(); ++i) { arguments_[i]->storeValue(*result.arguments_[i]); }
+        result.pushRow(error);
+    }
+
+    MW_INLINE void Parser::parseRows(const std::string *begin, const std::string *end, BatchResult &result)
+    {
+        std::string buffer;
+        std::vector<std::size_t> offsets;
+        std::vector<const char *> argv;
+        for(; begin != end; ++begin) { parseRow(*begin, result, buffer, offsets, argv); }
+    }
+
+#ifdef MW_POSIX
+    MW_INLINE std::size_t Parser::getTerminalWidth(const int fd)
+    {
+        struct winsize ws;
+        if(::ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) { return ws.ws_col; }
+
+        const char *columns = std::getenv("COLUMNS");
+        const int n = columns ? std::atoi(columns) : 0;
+        return n > 0 ? static_cast<std::size_t>(n) : 0;
+    }
+#endif
+
+    MW_INLINE void Parser::buildUsage(std::string &str, const std::size_t width) const
+    {
+        OptionList sorted(options_);
+        std::sort(sorted.begin(), sorted.end(), detail::KeySort());
+
+        std::size_t olen = 0, alen = 0, size = description_.size();
+        for(OptionList::const_iterator it = sorted.begin(); it != sorted.end(); ++it)
+        {
+            olen = std::max(olen, (*it)->getLongKey().size());
+            size += (*it)->getDesc().size() + (*it)->getName().size();
+        }
+
+        for(ArgumentList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it)
+        {
+            alen = std::max(alen, (*it)->getName().size());
+            size += (*it)->getDesc().size() + (*it)->getName().size();
+        }
+
+        olen += 2;
+        alen += 2;
+        str.reserve(size + (options_.size() + arguments_.size()) * (std::max(olen, alen) + 32) + 64);
+
+        detail::TextWriter writer(str, width);
+        std::string piece;
+
+        // synopsis
+        str.append("Usage:\n    ").append(appName_).append(" ");
+        const std::size_t indent = 4 + appName_.size() + 1;
+        writer.begin(indent, indent * 2 < width ? indent : 8);
+        for(OptionList::const_iterator it = sorted.begin(); it != sorted.end(); ++it)
+        {
+            piece.clear();
+            (*it)->buildArguments(piece);
+            writer.word(piece.data(), piece.size());
+        }
+
+        for(ArgumentList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it)
+        {
+            piece.clear();
+            (*it)->buildArguments(piece);
+            writer.word(piece.data(), piece.size());
+        }
+
+        writer.end();
+
+        // arguments
+        str.append("\nArguments:\n");
+        for(ArgumentList::const_iterator it = arguments_.begin(); it != arguments_.end(); ++it)
+        {
+            const detail::ArgumentBase *arg = *it;
+            str.append("    ").append(arg->getName().c_str()).append(alen - arg->getName().size() + 2, ' ');
+            writer.begin(4 + alen + 2, 4 + alen + 2);
+            if(arg->isOptional()) { writer.text("(optional)"); }
+            writer.text(arg->getDesc().c_str());
+            writer.end();
+        }
+
+        // options
+        str.append("\nOptions:\n");
+        for(OptionList::const_iterator it = sorted.begin(); it != sorted.end(); ++it)
+        {
+            const detail::OptionBase *option = *it;
+            if(option->getKey() != 0) { str.append("    -").append(1, option->getKey()).append("  --"); }
+            else                      { str.append("        --");                                         }
+            str.append(option->getLongKey().c_str());
+            str.append(olen - option->getLongKey().size(), ' ');
+            writer.begin(4 + 4 + olen + 2, 4 + 4 + olen + 2);
+            if(option->isOptional() && option->getKey() != 'h') { writer.text("(optional)"); }
+            writer.text(option->getDesc().c_str());
+            writer.end();
+        }
+
+        str += '\n';
+        writer.begin(0, 0);
+        writer.text(description_.c_str());
+        writer.end();
+    }
+
+    MW_INLINE Parser &Parser::addConstraint(const Keys *trigger, const Keys &keys, const std::size_t min, const std::size_t max)
+    {
+        Constraint c;
+        if(trigger) { c.trigger = trigger->keys_; }
+        c.keys = keys.keys_;
+        c.min = min;
+        c.max = max;
+        constraints_.push_back(c);
+        compiled_ = false;
+        return *this;
+    }
+
+    MW_INLINE Parser &Parser::add(detail::OptionBase *option) MW_THROW(std::runtime_error)
+    {
+        if(!findByKey(option->getKey()) && !findByLongKey(option->getLongKey().c_str()))
+        {
+            options_.push_back(option);
+            dirty_ = true;
+            compiled_ = false;
+        }
+        else
+        {
+            throw std::runtime_error("key is already registered in option list.");
+        }
+
+        return *this;
+    }
+
+    MW_INLINE Parser &Parser::add(detail::ArgumentBase *arg) MW_THROW(std::runtime_error)
+    {
+        if(varg_) { throw std::runtime_error("argument added after variable arguments."); }
+        if(!findByName(arg->getName().c_str()))
+        {
+            arguments_.push_back(arg);
+            if(arg->isMultiArg()) { varg_ = true; }
+            dirty_ = true;
+        }
+        else
+        {
+            throw std::runtime_error("name is already registered in argument list.");
+        }
+
+        return *this;
+    }
+
+#ifdef MW_POSIX
+    MW_INLINE ParseResult Parser::parseCommandLine()
+    {
+        std::vector<char> buffer;
+        const int fd = ::open("/proc/self/cmdline", O_RDONLY);
+        if(fd >= 0)
+        {
+            char chunk[4096];
+            for(ssize_t n; (n = ::read(fd, chunk, sizeof(chunk))) > 0; )
+            {
+                buffer.insert(buffer.end(), chunk, chunk + n);
+            }
+
+            ::close(fd);
+        }
+
+        if(buffer.empty())
+        {
+            errorMsg_ << "cannot read command line of this process.\n";
+            error_ = ENUM_ELEM(ParseError, Source);
+            return end();
+        }
+
+        return parse(&buffer[0], buffer.size());
+    }
+#endif
 
+    MW_INLINE void Parser::parseBatch(std::istream &is, BatchResult &result, const unsigned int threads)
+    {
+        if(!compiled_) { compile(); }
+        initBatch(result);
+
+        const bool silent = silent_;
+        silent_ = true;
 #ifdef MW_CPP11
-        template<
-            typename T,
-            typename... Args,
-            typename = typename std::enable_if<(sizeof...(Args) > 0)>::type
-        >
-        Parser &add(T &&t, Args &&...args) throw(std::runtime_error)
+        if(threads > 1)
         {
-            add(std::forward<T>(t));
-            return add(std::forward<Args>(args)...);
+            std::vector<std::string> lines;
+            for(std::string line; std::getline(is, line); ) { lines.push_back(line); }
+
+            const std::size_t n = std::min<std::size_t>(threads, std::max<std::size_t>(lines.size(), 1));
+            std::vector<Parser> workers(n);
+            std::vector<BatchResult> parts(n);
+            std::vector<std::thread> pool;
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                workers[i].copySchema(*this);
+                workers[i].silent_ = true;
+                workers[i].initBatch(parts[i]);
+
+                const std::string *first = lines.data() + lines.size() * i / n, *last = lines.data() + lines.size() * (i + 1) / n;
+                pool.push_back(std::thread(&Parser::parseRows, &workers[i], first, last, std::ref(parts[i])));
+            }
+
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                pool[i].join();
+                result.append(parts[i]);
+            }
         }
+        else
 #endif
+        {
+            std::string line, buffer;
+            std::vector<std::size_t> offsets;
+            std::vector<const char *> argv;
+            while(std::getline(is, line)) { parseRow(line, result, buffer, offsets, argv); }
+        }
 
-        /* options */
-        template<typename T>
-        Parser &add(const Option<T> &option) { return add(new Option<T>(option)); }
+        silent_ = silent;
+        clearState();
+    }
 
-        template<typename T>
-        Parser &add(Option<T> &option)
+    MW_INLINE bool Parser::loadConfig(const char *path, const char *snapshot)
+    {
+        detail::FileView file;
+        if(!file.open(path))
         {
-            option.ref_ = true;
-            return add(&option);
+            errorMsg_ << "cannot open config file: " << path << "\n";
+            error_ = ENUM_ELEM(ParseError, Source);
+            return false;
         }
 
-        /* arguments */
-        template<typename T>
-        Parser &add(const Argument<T> &arg) { return add(new Argument<T>(arg)); }
+#ifdef MW_POSIX
+        if(snapshot)
+        {
+            bool result;
+            if(loadSnapshot(snapshot, file, path, result)) { return result; }
 
-        template<typename T>
-        Parser &add(Argument<T> &arg)
+            std::string records;
+            if(!parseConfig(file.data(), file.size(), path, &records)) { return false; }
+
+            saveSnapshot(snapshot, file, convertRecords(records));
+            return true;
+        }
+#endif
+        return parseConfig(file.data(), file.size(), path, nullptr);
+    }
+
+    MW_INLINE bool Parser::loadEnvironment(const char *prefix)
+    {
+        std::string name;
+        for(OptionList::const_iterator it = options_.begin(); it != options_.end(); ++it)
         {
-            arg.ref_ = true;
-            return add(&arg);
+            detail::OptionBase *option = *it;
+            name.assign(prefix);
+            for(const char *c = option->getLongKey().c_str(); *c; ++c)
+            {
+                name.push_back(*c == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(*c))));
+            }
+
+            const char *value = std::getenv(name.c_str());
+            if(!value) { continue; }
+            if(!assignValue(option, value, std::strlen(value), detail::Layer_Environment, nullptr))
+            {
+                errorMsg_ << "invalid type was specified for " << option->getDisplayName() << " (" << name << ")\n";
+                error_ = ENUM_ELEM(ParseError, InvalidType);
+                return false;
+            }
         }
-    };
+
+        return true;
+    }
+
+    MW_INLINE const std::string &Parser::getUsage(const std::size_t width)
+    {
+        if(dirty_)
+        {
+            usages_.clear();
+            dirty_ = false;
+        }
+
+        // only a few widths are used
+        for(std::list<std::pair<std::size_t, std::string> >::iterator it = usages_.begin(); it != usages_.end(); ++it)
+        {
+            if(it->first == width) { return it->second; }
+        }
+
+        usages_.push_back(std::make_pair(width, std::string()));
+        buildUsage(usages_.back().second, width);
+        return usages_.back().second;
+    }
+
+    MW_INLINE void Parser::showUsage()
+    {
+#ifdef MW_POSIX
+        showUsage(STDOUT_FILENO);
+#else
+        std::cout << getUsage() << std::endl;
+#endif
+    }
+
+#ifdef MW_POSIX
+    MW_INLINE void Parser::showUsage(const int fd)
+    {
+        const std::string &usage = getUsage(getTerminalWidth(fd));
+        if(fd == STDOUT_FILENO) { std::cout.flush(); }
+
+        struct iovec iov[2];
+        iov[0].iov_base = const_cast<char *>(usage.data());
+        iov[0].iov_len = usage.size();
+        iov[1].iov_base = const_cast<char *>("\n");
+        iov[1].iov_len = 1;
+
+        struct iovec *p = iov;
+        for(int n = 2; n > 0; )
+        {
+            const ssize_t written = ::writev(fd, p, n);
+            if(written < 0)
+            {
+                if(errno == EINTR) { continue; }
+                break;
+            }
+
+            // skip written part on partial write
+            std::size_t rest = static_cast<std::size_t>(written);
+            for(; n > 0 && rest >= p->iov_len; --n, ++p) { rest -= p->iov_len; }
+            if(n > 0)
+            {
+                p->iov_base = static_cast<char *>(p->iov_base) + rest;
+                p->iov_len -= rest;
+            }
+        }
+    }
+#endif
 }
+#endif
+
+/*
+ * explicit instantiation for common value types.
+ * define CLIP_EXTERN_TEMPLATES and link clip.cpp to instantiate them only once.
+ */
+#if defined(MW_CPP11) && (defined(CLIP_EXTERN_TEMPLATES) || defined(CLIP_INSTANTIATE_TEMPLATES))
+#   ifdef CLIP_INSTANTIATE_TEMPLATES
+#       define MW_EXTERN
+#   else
+#       define MW_EXTERN extern
+#   endif
+namespace clip
+{
+    MW_EXTERN template class Argument<bool>;
+    MW_EXTERN template class Column<bool>;
+    MW_EXTERN template class Option<int>;
+    MW_EXTERN template class Argument<int>;
+    MW_EXTERN template class Column<int>;
+    MW_EXTERN template class Option<long>;
+    MW_EXTERN template class Argument<long>;
+    MW_EXTERN template class Column<long>;
+    MW_EXTERN template class Option<double>;
+    MW_EXTERN template class Argument<double>;
+    MW_EXTERN template class Column<double>;
+    MW_EXTERN template class Option<std::string>;
+    MW_EXTERN template class Argument<std::string>;
+    MW_EXTERN template class Column<std::string>;
+
+    MW_EXTERN template class Option<std::vector<bool> >;
+    MW_EXTERN template class Argument<std::vector<bool> >;
+    MW_EXTERN template class Column<std::vector<bool> >;
+    MW_EXTERN template class Option<std::vector<int> >;
+    MW_EXTERN template class Argument<std::vector<int> >;
+    MW_EXTERN template class Column<std::vector<int> >;
+    MW_EXTERN template class Option<std::vector<long> >;
+    MW_EXTERN template class Argument<std::vector<long> >;
+    MW_EXTERN template class Column<std::vector<long> >;
+    MW_EXTERN template class Option<std::vector<double> >;
+    MW_EXTERN template class Argument<std::vector<double> >;
+    MW_EXTERN template class Column<std::vector<double> >;
+    MW_EXTERN template class Option<std::vector<std::string> >;
+    MW_EXTERN template class Argument<std::vector<std::string> >;
+    MW_EXTERN template class Column<std::vector<std::string> >;
+
+    MW_EXTERN template class IntervalSet<int>;
+    MW_EXTERN template class Option<IntervalSet<int> >;
+    MW_EXTERN template class Argument<IntervalSet<int> >;
+    MW_EXTERN template class Column<IntervalSet<int> >;
+    MW_EXTERN template class IntervalSet<long>;
+    MW_EXTERN template class Option<IntervalSet<long> >;
+    MW_EXTERN template class Argument<IntervalSet<long> >;
+    MW_EXTERN template class Column<IntervalSet<long> >;
+}
+#   undef MW_EXTERN
+#endif
 
 #ifndef MW_CPP11
 #   undef final
@@ -794,7 +3738,10 @@ namespace clip
 #   undef nullptr
 #endif
 #undef ENUM_ELEM
+#undef MW_THROW
+#undef MW_INLINE
 #undef MW_CPP11
+#undef MW_POSIX
 
 #endif
 
@@ -0,0 +1,717 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include "clip.hpp"
+
+// build: g++ -std=c++11 test.cpp -o test && ./test
+
+// labels are views of string literals, so options stay small (LP64)
+static_assert(sizeof(void *) != 8 || sizeof(clip::Option<int>) <= 80, "Option<int> grew");
+static_assert(sizeof(void *) != 8 || sizeof(clip::Argument<int>) <= 64, "Argument<int> grew");
+static_assert(sizeof(void *) != 8 || sizeof(clip::Argument<std::vector<int> >) <= 104, "Argument<std::vector<int> > grew");
+
+static void testLabel()
+{
+    clip::Option<int> option('n', "number", "n", "a number");
+    const std::string name = option.getName();
+    assert(name == "n");
+    assert(option.getLongKey() + "=1" == "number=1");
+    assert("--" + option.getLongKey() == "--number");
+    assert(option.getDesc() == std::string("a number"));
+
+    // std::string is copied
+    std::string longkey = "count";
+    clip::Option<int> owned('c', longkey, "c", "count");
+    longkey = "other";
+    assert(owned.getLongKey() == "count");
+
+    // runtime buffers are copied, literals are referred
+    char buffer[16] = "size";
+    const std::string text = "depth";
+    clip::Option<int> fromBuffer('s', buffer, "s", text.c_str());
+    std::strcpy(buffer, "xxxx");
+    assert(fromBuffer.getLongKey() == "size" && fromBuffer.getDesc() == "depth");
+    static const char constant[] = "constant";
+    clip::Option<int> fromConstant('k', constant, "k", "constant");
+    assert(fromConstant.getLongKey().c_str() == constant);
+}
+
+static void testLongOnly()
+{
+    // options without short key do not conflict with each other
+    clip::Option<int> alpha(0, "alpha", "n", "alpha");
+    clip::Option<bool> beta(0, "beta", "beta");
+    clip::Option<int> dup(0, "alpha", "n", "same long key");
+    clip::Parser parser;
+    parser.add(alpha, beta);
+
+    bool thrown = false;
+    try { parser.add(dup); } catch(const std::runtime_error &) { thrown = true; }
+    assert(thrown);
+
+    const char *argv[] = { "app", "--alpha", "5", "--beta" };
+    const clip::ParseResult r = parser.parse(4, argv);
+    assert(r == clip::ParseResult::Success);
+    assert(alpha.getValue() == 5 && beta.getValue());
+    assert(alpha.getDisplayName() == "--alpha");
+}
+
+// small trivially copyable flags are stored in std::atomic, others are read by reference
+static_assert(std::is_same<clip::Flag<int>::value_type, int>::value, "Flag<int> is not atomic");
+static_assert(std::is_same<clip::Flag<double>::value_type, double>::value, "Flag<double> is not atomic");
+static_assert(std::is_same<clip::Flag<std::string>::value_type, const std::string &>::value, "Flag<std::string> is not a reference");
+
+static void testFlag()
+{
+    clip::Flag<int> count(0, "test-count", "n", "count", 3);
+    clip::Flag<std::string> label(0, "test-label", "text", "label", std::string("first"));
+    assert(count.get() == 3 && label.get() == "first");
+
+    // global parser takes description and error setting later, failed parse does not publish values
+    clip::Parser &parser = clip::getGlobalParser();
+    parser.setDescription("flag test");
+    parser.setShowErrors(false);
+    const char *argv[] = { "app", "--test-count", "x" };
+    const clip::ParseResult r = clip::parseGlobal(3, argv);
+    assert(r == clip::ParseResult::Failure && parser.getError() == clip::ParseError::InvalidType && count.get() == 3);
+    const std::string usage = parser.getUsage(0);
+    assert(usage.find("flag test") != std::string::npos);
+
+    const bool global = clip::setGlobal("test-count", "7");
+    assert(global && *count == 7);
+    const bool invalid = count.set("x");
+    assert(!invalid && count.get() == 7);
+
+    // replaced value stays valid for readers holding it
+    const std::string &held = label.get();
+    const bool replaced = label.set("second");
+    assert(replaced && held == "first" && label->size() == 6);
+
+    // readers see whole values while another thread updates them
+    std::atomic<bool> stop(false);
+    std::thread reader([&]() { while(!stop) { const std::string &value = label.get(); assert(value == "second" || value == "a" || value == "bb"); } });
+    for(int i = 0; i < 1000; ++i)
+    {
+        const bool updated = clip::setGlobal("test-label", i % 2 ? "a" : "bb");
+        assert(updated);
+    }
+    stop = true;
+    reader.join();
+    assert(*label == "a");
+}
+
+struct ConstraintOptions
+{
+    clip::Option<bool> json, xml, yaml;
+    clip::Option<std::string> user, password;
+    clip::Parser parser;
+
+    ConstraintOptions()
+    : json('j', "json", "json output"), xml('x', "xml", "xml output"), yaml(0, "yaml", "yaml output")
+    , user('u', "user", "name", "user", std::string()), password('p', "password", "text", "password", std::string())
+    {
+        parser.add(json, xml, yaml, user, password);
+    }
+
+    clip::ParseError parse(const int argc, const char *argv[])
+    {
+        const clip::ParseResult r = parser.parse(argc, argv);
+        assert((r == clip::ParseResult::Success) == (parser.getError() == clip::ParseError::None));
+        return parser.getError();
+    }
+};
+
+static void testConstraints()
+{
+    const char *none[] = { "app" };
+    const char *jsonXml[] = { "app", "-j", "--xml" };
+    const char *yaml[] = { "app", "--yaml" };
+    const char *all[] = { "app", "-j", "-x", "--yaml" };
+    const char *user[] = { "app", "-u", "bob" };
+    const char *login[] = { "app", "-u", "bob", "--password", "secret" };
+
+    // exclusive: at most one
+    {
+        ConstraintOptions o;
+        o.parser.exclusive(clip::Keys('j')('x'));
+        const clip::ParseError e = o.parse(3, jsonXml);
+        assert(e == clip::ParseError::Constraint);
+    }
+    {
+        ConstraintOptions o;
+        o.parser.exclusive(clip::Keys('j')('x'));
+        const clip::ParseError e = o.parse(2, yaml);
+        assert(e == clip::ParseError::None);
+    }
+
+    // atLeastOne, long keys are accepted
+    {
+        ConstraintOptions o;
+        o.parser.atLeastOne(clip::Keys('j')('x')("yaml"));
+        const clip::ParseError e = o.parse(1, none);
+        assert(e == clip::ParseError::Constraint);
+    }
+    {
+        ConstraintOptions o;
+        o.parser.atLeastOne(clip::Keys('j')('x')("yaml"));
+        const clip::ParseError e = o.parse(2, yaml);
+        assert(e == clip::ParseError::None);
+    }
+
+    // count: exactly 2
+    {
+        ConstraintOptions o;
+        o.parser.count(clip::Keys('j')('x')("yaml"), 2, 2);
+        const clip::ParseError e = o.parse(2, yaml);
+        assert(e == clip::ParseError::Constraint);
+    }
+    {
+        ConstraintOptions o;
+        o.parser.count(clip::Keys('j')('x')("yaml"), 2, 2);
+        const clip::ParseError e = o.parse(3, jsonXml);
+        assert(e == clip::ParseError::None);
+    }
+    {
+        ConstraintOptions o;
+        o.parser.count(clip::Keys('j')('x')("yaml"), 2, 2);
+        const clip::ParseError e = o.parse(4, all);
+        assert(e == clip::ParseError::Constraint);
+        assert(o.parser.getErrorMessage().find("at most 2") != std::string::npos);
+    }
+
+    // depends: user requires password, nothing specified is fine
+    {
+        ConstraintOptions o;
+        o.parser.depends(clip::Keys('u'), clip::Keys("password"));
+        const clip::ParseError e = o.parse(3, user);
+        assert(e == clip::ParseError::Constraint);
+    }
+    {
+        ConstraintOptions o;
+        o.parser.depends(clip::Keys('u'), clip::Keys("password"));
+        const clip::ParseError e = o.parse(5, login);
+        assert(e == clip::ParseError::None);
+    }
+    {
+        ConstraintOptions o;
+        o.parser.depends(clip::Keys('u'), clip::Keys("password"));
+        const clip::ParseError e = o.parse(1, none);
+        assert(e == clip::ParseError::None);
+    }
+
+    // unknown key in constraint
+    {
+        ConstraintOptions o;
+        bool thrown = false;
+        try { o.parser.exclusive(clip::Keys('j')("unknown")); o.parse(1, none); } catch(const std::runtime_error &) { thrown = true; }
+        assert(thrown);
+    }
+
+    // options and constraints added after compile are used by the next parse
+    {
+        clip::Option<bool> a('a', "aa", "a"), b('b', "bb", "b");
+        clip::Parser parser;
+        parser.add(a);
+        const clip::ParseResult first = parser.parse(1, none);
+        assert(first == clip::ParseResult::Success);
+
+        parser.add(b);
+        parser.exclusive(clip::Keys('a')('b'));
+        const char *both[] = { "app", "-a", "-b" };
+        const clip::ParseResult second = parser.parse(3, both);
+        assert(second == clip::ParseResult::Failure && parser.getError() == clip::ParseError::Constraint);
+        assert(a.getValue() && b.getValue());
+    }
+}
+
+struct BatchOptions
+{
+    clip::Option<int> number;
+    clip::Option<bool> verbose;
+    clip::Option<std::vector<int> > list;
+    clip::Parser parser;
+
+    BatchOptions()
+    : number('n', "number", "n", "number"), verbose('v', "verbose", "verbose"), list('l', "list", "n", "list", std::vector<int>())
+    {
+        parser.add(number, verbose, list);
+    }
+};
+
+static clip::ParseError expectedError(const int row)
+{
+    if(row % 7 == 0)  { return clip::ParseError::InvalidType; }
+    if(row % 11 == 0) { return clip::ParseError::Missing; }
+    if(row % 13 == 0) { return clip::ParseError::InvalidName; }
+    if(row % 17 == 0) { return clip::ParseError::HelpRequested; }
+    return clip::ParseError::None;
+}
+
+static void checkBatch(const clip::BatchResult &result, const int rows)
+{
+    assert(result.getRows() == static_cast<std::size_t>(rows));
+    const clip::Column<int> &number = result.getOption<int>("number");
+    const clip::Column<bool> &verbose = result.getOption<bool>('v');
+    const clip::Column<std::vector<int> > &list = result.getOption<std::vector<int> >("list");
+    const std::size_t *offsets = list.getOffsets();
+
+    for(int row = 0; row < rows; ++row)
+    {
+        const clip::ParseError error = expectedError(row);
+        assert(result.getError(row) == error && result.getErrors()[row] == static_cast<unsigned char>(error));
+        const bool valid = error == clip::ParseError::None;
+        assert(result.isValid(row) == valid && (((result.getValidBitmap()[row / 64] >> (row % 64)) & 1) != 0) == valid);
+        if(!valid) { continue; }
+
+        // values are kept in input order
+        assert(number.isSet(row) && number[row] == row);
+        assert(verbose.isSet(row) == (row % 2 == 1) && (verbose[row] != 0) == (row % 2 == 1));
+        assert(list.isSet(row) && offsets[row + 1] - offsets[row] == 2);
+        assert(list.data()[offsets[row]] == row && list.data()[offsets[row] + 1] == row + 1);
+    }
+}
+
+static void testBatch()
+{
+    const int rows = 1000;
+    std::string input;
+    for(int row = 0; row < rows; ++row)
+    {
+        std::ostringstream line;
+        if(row % 7 == 0)       { line << "app -n 1 -l x"; }
+        else if(row % 11 == 0) { line << "app -v"; }
+        else if(row % 13 == 0) { line << "app -n 1 -q"; }
+        else if(row % 17 == 0) { line << "app -n 1 -h"; }
+        else                   { line << "app -n " << row << (row % 2 ? " -v" : "") << " -l " << row << " " << row + 1; }
+        input.append(line.str()).push_back('\n');
+    }
+
+    BatchOptions o;
+    for(unsigned int threads = 1; threads <= 4; threads += 3)
+    {
+        std::istringstream is(input);
+        clip::BatchResult result;
+        o.parser.parseBatch(is, result, threads);
+        checkBatch(result, rows);
+    }
+
+    // values of batch do not remain in options
+    assert(!o.verbose.getValue() && o.list.getValue().empty());
+}
+
+static void testSourceErrors()
+{
+    {
+        BatchOptions o;
+        const bool loaded = o.parser.loadConfig("clip-test-missing.conf");
+        assert(!loaded && o.parser.getError() == clip::ParseError::Source);
+        const char *argv[] = { "app", "-n", "1" };
+        const clip::ParseResult r = o.parser.parse(3, argv);
+        assert(r == clip::ParseResult::Failure && o.parser.getError() == clip::ParseError::Source);
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    {
+        BatchOptions o;
+        setenv("CLIPTEST_NUMBER", "x", 1);
+        const bool loaded = o.parser.loadEnvironment("CLIPTEST_");
+        unsetenv("CLIPTEST_NUMBER");
+        assert(!loaded && o.parser.getError() == clip::ParseError::InvalidType);
+    }
+#endif
+}
+
+static void testBuffer()
+{
+    // NUL separated tokens like /proc/self/cmdline, the last token may not be terminated
+    {
+        BatchOptions o;
+        const char buffer[] = { 'a', 'p', 'p', 0, '-', 'n', 0, '4', '2', 0, '-', 'l', 0, '1', 0, '2', '3' };
+        const clip::ParseResult r = o.parser.parse(buffer, sizeof(buffer));
+        assert(r == clip::ParseResult::Success);
+        assert(o.parser.getAppName() == "app" && o.number.getValue() == 42);
+        assert(o.list.getValue() == std::vector<int>({ 1, 23 }));
+    }
+    {
+        BatchOptions o;
+        const char buffer[] = "app\0-v\0-n\0007\0";
+        const clip::ParseResult r = o.parser.parse(buffer, sizeof(buffer) - 1);
+        assert(r == clip::ParseResult::Success);
+        assert(o.verbose.getValue() && o.number.getValue() == 7);
+    }
+
+    // empty buffer has no program name and no options
+    {
+        BatchOptions o;
+        const clip::ParseResult r = o.parser.parse("", 0);
+        assert(r == clip::ParseResult::Failure && o.parser.getError() == clip::ParseError::Missing);
+        assert(o.parser.getAppName().empty());
+    }
+    {
+        clip::Option<bool> flag('f', "flag", "flag");
+        clip::Parser parser;
+        parser.add(flag);
+        const clip::ParseResult r = parser.parse("", 0);
+        assert(r == clip::ParseResult::Success && !flag.getValue());
+    }
+}
+
+static void testUsage()
+{
+    clip::Option<int> number('n', "number", "n", "a number used by the test to check that long descriptions are wrapped at the width");
+    clip::Option<std::string> name('s', "name", "text", "short", std::string());
+    clip::Parser parser("usage test");
+    parser.add(number, name);
+
+    // cached strings stay at the same address while other widths are built
+    const std::string &plain = parser.getUsage(0);
+    const std::string &narrow = parser.getUsage(40);
+    const std::string copy = narrow;
+    const std::string &wider = parser.getUsage(50);
+    const std::string &wide = parser.getUsage(60);
+    const std::string &narrowAgain = parser.getUsage(40);
+    const std::string &plainAgain = parser.getUsage();
+    assert(&narrowAgain == &narrow && &plainAgain == &plain);
+    assert(narrow == copy && !plain.empty() && !wider.empty() && !wide.empty());
+
+    // unwrapped usage has the description in one line, wrapped lines fit the width
+    assert(plain.find("a number used by the test to check that long descriptions are wrapped at the width") != std::string::npos);
+    std::istringstream is(narrow);
+    std::size_t lines = 0;
+    for(std::string line; std::getline(is, line); ++lines) { assert(line.size() <= 40); }
+    assert(lines > static_cast<std::size_t>(std::count(plain.begin(), plain.end(), '\n')));
+
+    // description set later is shown
+    parser.setDescription("renamed test");
+    const std::string described = parser.getUsage(40);
+    assert(described.find("renamed test") != std::string::npos && described.find("usage test") == std::string::npos);
+
+    // program name and options invalidate the cache
+    const char *argv[] = { "/usr/bin/tool", "-n", "1" };
+    const clip::ParseResult r = parser.parse(3, argv);
+    assert(r == clip::ParseResult::Success);
+    const std::string renamed = parser.getUsage(40);
+    assert(renamed.find("    tool ") != std::string::npos);
+
+    clip::Option<bool> extra('e', "extra", "extra");
+    parser.add(extra);
+    const std::string added = parser.getUsage(40);
+    assert(added.find("--extra") != std::string::npos);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+static void writeFile(const char *path, const char *text)
+{
+    std::FILE *fp = std::fopen(path, "wb");
+    assert(fp);
+    std::fputs(text, fp);
+    std::fclose(fp);
+}
+
+static void testMappedFile()
+{
+    writeFile("clip-test-input.txt", "hello");
+    {
+        clip::Option<clip::MappedFile> input('i', "input", "file", "input file");
+        clip::Parser parser;
+        parser.add(input);
+        const char *argv[] = { "app", "-i", "clip-test-missing.txt" };
+        const clip::ParseResult r = parser.parse(3, argv);
+        assert(r == clip::ParseResult::Failure && parser.getError() == clip::ParseError::Source);
+        assert(parser.getErrorMessage().find("cannot open file: clip-test-missing.txt") != std::string::npos);
+    }
+    {
+        clip::Option<std::vector<clip::MappedFile> > inputs('i', "inputs", "file", "input files");
+        clip::Parser parser;
+        parser.add(inputs);
+        const char *argv[] = { "app", "-i", "clip-test-input.txt", "clip-test-missing.txt" };
+        const clip::ParseResult r = parser.parse(4, argv);
+        assert(r == clip::ParseResult::Failure && parser.getError() == clip::ParseError::Source);
+    }
+
+    // existing file is mapped on first access
+    {
+        clip::Option<clip::MappedFile> input('i', "input", "file", "input file");
+        clip::Parser parser;
+        parser.add(input);
+        const char *argv[] = { "app", "-i", "clip-test-input.txt" };
+        const clip::ParseResult r = parser.parse(3, argv);
+        assert(r == clip::ParseResult::Success);
+
+        const clip::MappedFile file = input.getValue();
+        assert(!file.isMapped());
+        const std::size_t size = file.size();
+        assert(size == 5 && file.isMapped() && std::memcmp(file.data(), "hello", 5) == 0);
+    }
+
+    // invalid value of other types is a type error, not a missing argument
+    {
+        clip::Option<int> number('n', "number", "n", "number");
+        clip::Parser parser;
+        parser.add(number);
+        const char *argv[] = { "app", "-n", "x" };
+        const clip::ParseResult r = parser.parse(3, argv);
+        assert(r == clip::ParseResult::Failure && parser.getError() == clip::ParseError::InvalidType);
+    }
+
+    std::remove("clip-test-input.txt");
+}
+
+struct ConfigOptions
+{
+    clip::Option<int> y, z;
+    clip::Option<std::vector<int> > list;
+    clip::Option<std::string> name;
+    clip::Parser parser;
+
+    ConfigOptions()
+    : y('y', "yy", "n", "y", 0), z('z', "zz", "n", "z", 0), list('l', "list", "n", "list"), name('n', "name", "s", "name", std::string("none"))
+    {
+        parser.add(y, z, list, name);
+    }
+};
+
+static void testConfig()
+{
+    const char *a = "clip-test-a.conf", *b = "clip-test-b.conf", *snap = "clip-test-b.snap";
+    std::remove(snap);
+    writeFile(a, "yy = 5\nlist = 1 2\nname = a\n");
+    writeFile(b, "zz = 1\nlist = 3\n");
+
+    // later files override single values and append multiple values, snapshot is created
+    {
+        ConfigOptions o;
+        const bool loaded = o.parser.loadConfig(a) && o.parser.loadConfig(b, snap);
+        assert(loaded);
+        assert(o.y.getValue() == 5 && o.z.getValue() == 1 && o.name.getValue() == "a");
+        assert(o.list.getValue() == std::vector<int>({ 1, 2, 3 }));
+    }
+
+    // snapshot of b is restored, and does not contain values of a
+    writeFile(a, "yy = 6\nlist = 4 5\n");
+    {
+        ConfigOptions o;
+        const bool loaded = o.parser.loadConfig(a) && o.parser.loadConfig(b, snap);
+        assert(loaded);
+        assert(o.y.getValue() == 6 && o.z.getValue() == 1 && o.name.getValue() == "none");
+        assert(o.list.getValue() == std::vector<int>({ 4, 5, 3 }));
+    }
+
+    // snapshot loaded first, then overridden by environment and command line
+    {
+        ConfigOptions o;
+        setenv("CLIPTEST_ZZ", "2", 1);
+        setenv("CLIPTEST_YY", "7", 1);
+        const bool loaded = o.parser.loadConfig(b, snap) && o.parser.loadConfig(a) && o.parser.loadEnvironment("CLIPTEST_");
+        assert(loaded);
+        const char *argv[] = { "app", "-y", "8" };
+        const clip::ParseResult r = o.parser.parse(3, argv);
+        assert(r == clip::ParseResult::Success);
+        assert(o.y.getValue() == 8 && o.z.getValue() == 2);
+        assert(o.list.getValue() == std::vector<int>({ 3, 4, 5 }));
+        unsetenv("CLIPTEST_ZZ");
+        unsetenv("CLIPTEST_YY");
+    }
+
+    // errors in config file have their codes
+    {
+        ConfigOptions o;
+        writeFile(a, "yy = x\n");
+        const bool loaded = o.parser.loadConfig(a);
+        assert(!loaded && o.parser.getError() == clip::ParseError::InvalidType);
+    }
+    {
+        ConfigOptions o;
+        writeFile(a, "unknown = 1\n");
+        const bool loaded = o.parser.loadConfig(a);
+        assert(!loaded && o.parser.getError() == clip::ParseError::InvalidName);
+    }
+
+    std::remove(a);
+    std::remove(b);
+    std::remove(snap);
+}
+#endif
+
+typedef clip::IntervalSet<int> IntSet;
+
+static void checkRuns(const IntSet &set);
+
+static void check(const IntSet &set, const std::set<int> &expected)
+{
+    assert(set.size() == expected.size());
+    std::set<int>::const_iterator e = expected.begin();
+    for(IntSet::const_iterator it = set.begin(); it != set.end(); ++it, ++e) { assert(*it == *e); }
+    assert(e == expected.end());
+
+    checkRuns(set);
+}
+
+static void checkRuns(const IntSet &set)
+{
+    // runs are sorted and their spans do not overlap, parts of groups stay in the span
+    const std::vector<IntSet::Interval> &runs = set.getIntervals();
+    for(std::size_t i = 0; i < runs.size(); ++i)
+    {
+        assert(runs[i].first <= runs[i].last);
+        assert(i == 0 || runs[i - 1].last < runs[i].first);
+        if(runs[i].step != 0) { continue; }
+
+        const std::vector<IntSet::Interval> &parts = set.getParts(runs[i]);
+        assert(parts.size() > 1);
+        for(std::size_t j = 0; j < parts.size(); ++j) { assert(runs[i].first <= parts[j].first && parts[j].last <= runs[i].last && parts[j].step > 1); }
+    }
+}
+
+// compare with bitmap of values in [0, hit.size())
+static void check(const IntSet &set, const std::vector<bool> &hit)
+{
+    unsigned long long n = 0;
+    int prev = -1;
+    for(IntSet::const_iterator it = set.begin(); it != set.end(); ++it, ++n)
+    {
+        assert(*it > prev && hit[*it]);
+        prev = *it;
+    }
+    for(std::size_t v = 0; v < hit.size(); ++v) { assert(set.contains(static_cast<int>(v)) == hit[v]); }
+    assert(set.size() == n && n == static_cast<unsigned long long>(std::count(hit.begin(), hit.end(), true)));
+    checkRuns(set);
+}
+
+static void testIntervalSet()
+{
+    // adjacent and overlapping ranges are joined
+    IntSet set;
+    set.insert(0, 9);
+    set.insert(10, 19);
+    set.insert(5, 25);
+    assert(set.getIntervals().size() == 1 && set.size() == 26);
+
+    // single values continue a stepped run
+    set.clear();
+    for(int i = 0; i < 100; i += 3) { set.insert(i); }
+    assert(set.getIntervals().size() == 1 && set.getIntervals()[0].step == 3);
+
+    // evenly spaced union of different residues is one run
+    set.clear();
+    set.insert(0, 1000000, 2);
+    set.insert(1, 1000001, 2);
+    assert(set.getIntervals().size() == 1 && set.size() == 1000002);
+    set.clear();
+    set.insert(0, 1000000, 4);
+    set.insert(2, 1000000, 4);
+    assert(set.getIntervals().size() == 1 && set.getIntervals()[0].step == 2);
+
+    // bounds of the value type
+    set.clear();
+    set.insert(INT_MIN, INT_MAX);
+    set.insert(0, 100, 7);
+    assert(set.getIntervals().size() == 1 && set.size() == 1ULL << 32);
+    assert(set.contains(INT_MIN) && set.contains(INT_MAX));
+
+    // interleaving which needs too many single values is kept as a group
+    set.clear();
+    set.insert(0, 1000000000, 2);
+    set.insert(1, 1000000000, 3);
+    assert(set.getIntervals().size() == 2 && set.getIntervals()[1].step == 0 && set.getParts(set.getIntervals()[1]).size() == 2);
+    assert(set.size() == 666666668);
+    assert(set.contains(0) && set.contains(1) && !set.contains(5) && set.contains(999999998) && set.contains(1000000000) && !set.contains(999999999));
+    {
+        IntSet::const_iterator it = set.begin();
+        const int values[] = { 0, 1, 2, 4, 6, 7, 8, 10 };
+        for(std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i, ++it) { assert(*it == values[i]); }
+    }
+
+    // values joined to a group split it where they are dense
+    set.insert(100, 199);
+    assert(set.contains(150) && !set.contains(5) && set.size() == 666666668 + 100 - 67);
+    checkRuns(set);
+
+    // groups are written as their parts
+    {
+        std::string data;
+        clip::detail::Codec<IntSet>::write(data, set);
+        IntSet restored;
+        const bool decoded = clip::detail::decode(data.data(), data.size(), restored);
+        assert(decoded && restored.size() == set.size() && restored.getIntervals().size() == set.getIntervals().size());
+        assert(restored.contains(1000000000) && !restored.contains(999999999));
+    }
+
+    {
+        clip::Option<IntSet> ids('i', "ids", "ids", "id list");
+        clip::Parser parser;
+        parser.add(ids);
+        const char *argv[] = { "app", "-i", "0:100000:2", "0:100000:3" };
+        const clip::ParseResult r = parser.parse(4, argv);
+        assert(r == clip::ParseResult::Success);
+        assert(ids.getValue().size() == 66668 && ids.getValue().contains(99999) && !ids.getValue().contains(99995));
+    }
+    {
+        clip::Option<IntSet> ids('i', "ids", "ids", "id list");
+        clip::Parser parser;
+        parser.add(ids);
+        const char *argv[] = { "app", "-i", "0:100:2,1:101:2", "200:300:3,200:300:5" };
+        const clip::ParseResult r = parser.parse(4, argv);
+        assert(r == clip::ParseResult::Success);
+        assert(ids.getValue().getIntervals()[0].last == 101 && ids.getValue().contains(285) && !ids.getValue().contains(286));
+    }
+
+    // compare with std::set for random small ranges
+    std::srand(1);
+    for(int round = 0; round < 2000; ++round)
+    {
+        set.clear();
+        std::set<int> expected;
+        for(int n = std::rand() % 8; n >= 0; --n)
+        {
+            const int first = std::rand() % 200 - 100;
+            const int last = first + std::rand() % 60;
+            const int step = 1 + std::rand() % 6;
+            set.insert(first, last, step);
+            for(int v = first; v <= last; v += step) { expected.insert(v); }
+            check(set, expected);
+        }
+        for(int v = -110; v < 170; ++v) { assert(set.contains(v) == (expected.count(v) != 0)); }
+    }
+
+    // long ranges make groups, which are split and joined again by later ranges
+    for(int round = 0; round < 60; ++round)
+    {
+        set.clear();
+        std::vector<bool> hit(40000, false);
+        for(int n = std::rand() % 6; n >= 0; --n)
+        {
+            const int first = std::rand() % 20000;
+            const int last = first + std::rand() % 20000;
+            const int step = std::rand() % 4 == 0 ? 1 + std::rand() % 3 : 2 + std::rand() % 12;
+            set.insert(first, last, step);
+            for(int v = first; v <= last; v += step) { hit[v] = true; }
+            check(set, hit);
+        }
+    }
+}
+
+int main()
+{
+    testLabel();
+    testLongOnly();
+    testFlag();
+    testConstraints();
+    testBatch();
+    testBuffer();
+    testUsage();
+    testSourceErrors();
+#if defined(__unix__) || defined(__APPLE__)
+    testMappedFile();
+    testConfig();
+#endif
+    testIntervalSet();
+    std::cout << "ok" << std::endl;
+    return 0;
+}